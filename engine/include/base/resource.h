@@ -10,6 +10,7 @@ enum class ResourceType
 {
   Sound,
   Model,
+  Music, // a hint: the music might be played soon. 'path' is unused.
 };
 
 struct Resource
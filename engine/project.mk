@@ -9,7 +9,9 @@ SRCS_ENGINE:=\
 	$(ENGINE_ROOT)/src/misc/base64.cpp\
 	$(ENGINE_ROOT)/src/misc/decompress.cpp\
 	$(ENGINE_ROOT)/src/misc/file.cpp\
+	$(ENGINE_ROOT)/src/misc/jobs.cpp\
 	$(ENGINE_ROOT)/src/misc/json.cpp\
+	$(ENGINE_ROOT)/src/misc/replay.cpp\
 	$(ENGINE_ROOT)/src/render/display_ogl.cpp\
 	$(ENGINE_ROOT)/src/render/glad.cpp\
 	$(ENGINE_ROOT)/src/render/model.cpp\
@@ -11,6 +11,9 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdlib> // srand
+#include <cstring> // strcmp
+#include <ctime>
 
 #include "SDL.h"
 
@@ -21,6 +24,8 @@
 #include "app.h"
 #include "ratecounter.h"
 #include "audio/audio.h"
+#include "misc/jobs.h"
+#include "misc/replay.h"
 #include "render/display.h"
 
 using namespace std;
@@ -36,13 +41,28 @@ class App : View, public IApp
 {
 public:
   App(Span<char*> args)
-    : m_args({ args.data, args.data + args.len })
   {
+    for(int i = 0; i < args.len; ++i)
+    {
+      if(!strcmp(args[i], "--record") && i + 1 < args.len)
+        m_recordPath = args[++i];
+      else if(!strcmp(args[i], "--jobs") && i + 1 < args.len)
+        startJobSystem(atoi(args[++i]));
+      else
+        m_args.push_back(args[i]);
+    }
+
     SDL_Init(0);
 
     m_display.reset(createDisplay(Size2i(512, 512)));
     m_audio.reset(createAudio());
 
+    // the only sources of nondeterminism are the seed and the controls:
+    // both are recorded.
+    m_replay.seed = time(nullptr);
+    m_replay.args = m_args;
+
+    srand(m_replay.seed);
     m_scene.reset(createGame(this, m_args));
 
     m_lastTime = SDL_GetTicks();
@@ -50,12 +70,25 @@ public:
 
   virtual ~App()
   {
+    if(!m_recordPath.empty())
+    {
+      try
+      {
+        saveReplay(m_replay, m_recordPath);
+      }
+      catch(exception const& e)
+      {
+        fprintf(stderr, "Can't save replay: %s\n", e.what());
+      }
+    }
+
     SDL_Quit();
   }
 
   bool tick() override
   {
     processInput();
+    m_audio->update();
 
     auto const now = (int)SDL_GetTicks();
     bool dirty = false;
@@ -75,6 +108,9 @@ public:
           m_scene.release();
           m_scene.reset(next);
         }
+
+        if(!m_recordPath.empty())
+          m_replay.ticks.push_back({ m_control, computeChecksum() });
       }
 
       dirty = true;
@@ -134,6 +170,19 @@ private:
     m_control.debug = keys[SDL_SCANCODE_SCROLLLOCK];
   }
 
+  uint32_t computeChecksum()
+  {
+    m_actors.clear();
+    m_scene->draw();
+
+    FrameHash hash;
+
+    for(auto& actor : m_actors)
+      hash.add(actor);
+
+    return hash.value;
+  }
+
   void draw()
   {
     m_display->beginDraw();
@@ -184,7 +233,12 @@ private:
       onQuit();
 
     if(evt->key.keysym.sym == SDLK_F2)
+    {
+      // restart the recording too
+      m_replay.ticks.clear();
+      srand(m_replay.seed);
       m_scene.reset(createGame(this, m_args));
+    }
 
     if(evt->key.keysym.sym == SDLK_TAB)
       m_slowMotion = !m_slowMotion;
@@ -227,6 +281,9 @@ private:
     case ResourceType::Model:
       m_display->loadModel(res.id, res.path);
       break;
+    case ResourceType::Music:
+      m_audio->preloadMusic(res.id);
+      break;
     }
   }
 
@@ -274,6 +331,8 @@ private:
   RateCounter m_fps;
   Control m_control {};
   vector<string> m_args;
+  string m_recordPath;
+  Replay m_replay;
   unique_ptr<Scene> m_scene;
   bool m_slowMotion = false;
   bool m_fullscreen = false;
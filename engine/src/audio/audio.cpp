@@ -12,8 +12,12 @@
 #include "sound.h"
 
 #include <cstdio> // printf
+#include <algorithm> // find
 #include <cstring> // strcpy
+#include <chrono>
 #include <cmath> // sin
+#include <future>
+#include <map>
 #include <vector>
 #include <memory>
 
@@ -74,6 +78,101 @@ struct HighLevelAudio : Audio
   void playMusic(int id) override
   {
     char path[256];
+    id = getMusicPath(id, path);
+
+    if(id == currMusic)
+    {
+      nextMusic = -1;
+      return;
+    }
+
+    nextMusic = id;
+    startLoading(id, path);
+    update();
+  }
+
+  void update() override
+  {
+    if(nextMusic < 0)
+      return;
+
+    auto i = m_preloadedMusic.find(nextMusic);
+
+    if(i->second.wait_for(chrono::seconds(0)) != future_status::ready)
+      return;
+
+    auto music = i->second.get();
+    forget(nextMusic);
+
+    currMusic = nextMusic;
+    nextMusic = -1;
+
+    m_backend->playLoopOnChannelZero(music.release());
+  }
+
+  void preloadMusic(int id) override
+  {
+    char path[256];
+    id = getMusicPath(id, path);
+
+    if(id == currMusic)
+      return;
+
+    startLoading(id, path);
+  }
+
+  void startLoading(int id, const char* path)
+  {
+    // the destructor of a future from 'async' blocks until the task is done:
+    // only destroy the abandoned ones once they're ready.
+    m_abandoned.erase(remove_if(m_abandoned.begin(), m_abandoned.end(), isReady), m_abandoned.end());
+
+    if(m_preloadedMusic.count(id))
+    {
+      // requested again: now the most recent one
+      m_preloadOrder.erase(find(m_preloadOrder.begin(), m_preloadOrder.end(), id));
+      m_preloadOrder.push_back(id);
+      return;
+    }
+
+    string filename = path;
+    m_preloadedMusic[id] = async(launch::async, [filename] () { return loadSoundFile(filename); });
+    m_preloadOrder.push_back(id);
+
+    // the themes of the rooms the player didn't go to
+    for(int k = 0; (int)m_preloadedMusic.size() > MAX_PRELOADED_MUSIC && k < (int)m_preloadOrder.size();)
+    {
+      auto const oldest = m_preloadOrder[k];
+
+      if(oldest == nextMusic)
+      {
+        ++k;
+        continue;
+      }
+
+      auto& loading = m_preloadedMusic[oldest];
+
+      if(!isReady(loading))
+        m_abandoned.push_back(move(loading));
+
+      forget(oldest);
+    }
+  }
+
+  void forget(int id)
+  {
+    m_preloadedMusic.erase(id);
+    m_preloadOrder.erase(find(m_preloadOrder.begin(), m_preloadOrder.end(), id));
+  }
+
+  static bool isReady(future<unique_ptr<Sound>> const& f)
+  {
+    return f.wait_for(chrono::seconds(0)) == future_status::ready;
+  }
+
+  // returns the id of the music actually found at 'path'
+  static int getMusicPath(int id, char (&path)[256])
+  {
     sprintf(path, "res/music/music-%02d.ogg", id);
 
     if(!exists(path))
@@ -83,21 +182,24 @@ struct HighLevelAudio : Audio
       id = 0;
     }
 
-    if(id == currMusic)
-      return;
-
-    currMusic = id;
-
-    m_backend->playLoopOnChannelZero(loadSoundFile(path).release());
+    return id;
   }
 
   void stopMusic() override
   {
     m_backend->stopLoopOnChannelZero();
     currMusic = -1;
+    nextMusic = -1;
   }
 
+  // a room has few neighbours: enough for the themes of the next rooms
+  static auto const MAX_PRELOADED_MUSIC = 4;
+
   int currMusic = -1;
+  int nextMusic = -1; // still loading
+  map<int, future<unique_ptr<Sound>>> m_preloadedMusic;
+  vector<int> m_preloadOrder; // of the keys of 'm_preloadedMusic', oldest first
+  vector<future<unique_ptr<Sound>>> m_abandoned; // still loading
   const unique_ptr<IAudioBackend> m_backend;
   vector<unique_ptr<Sound>> sounds;
 };
@@ -12,7 +12,16 @@ struct Audio
 
   virtual void loadSound(int id, const char* path) = 0;
   virtual void playSound(int id) = 0;
+
+  // the music is loaded in the background if needed:
+  // the current one keeps playing until then.
   virtual void playMusic(int id) = 0;
+
+  // starts loading the music in the background, so 'playMusic' doesn't wait
+  virtual void preloadMusic(int id) = 0;
   virtual void stopMusic() = 0;
+
+  // switches to the requested music once it's loaded. Call once per frame.
+  virtual void update() = 0;
 };
 
@@ -0,0 +1,16 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#pragma once
+
+#include <chrono>
+
+// monotonic time, in seconds, for measurements
+inline double now()
+{
+  auto const t = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double>(t).count();
+}
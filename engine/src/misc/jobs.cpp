@@ -0,0 +1,212 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "jobs.h"
+#include <algorithm> // min
+#include <iterator> // next
+
+namespace
+{
+// the job system whose worker the current thread is, and its queue
+thread_local const JobSystem* t_system = nullptr;
+thread_local int t_queue = 0;
+}
+
+JobSystem::JobSystem(int numWorkers)
+  : m_queuedJobs(0)
+{
+  for(int i = 0; i <= numWorkers; ++i)
+    m_queues.push_back(make_unique<Queue>());
+
+  for(int i = 1; i <= numWorkers; ++i)
+    m_threads.push_back(thread(&JobSystem::workerMain, this, i));
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    lock_guard<mutex> guard(m_sleepLock);
+    m_quit = true;
+  }
+
+  m_wakeup.notify_all();
+
+  for(auto& t : m_threads)
+    t.join();
+}
+
+void JobSystem::parallelFor(int count, int grain, function<void(int, int)> const& func)
+{
+  grain = max(1, grain);
+
+  auto const numJobs = (count + grain - 1) / grain;
+
+  Batch batch;
+  batch.func = &func;
+  batch.pending = numJobs;
+
+  // not worth the synchronization
+  if(m_threads.empty() || count <= grain)
+  {
+    for(int begin = 0; begin < count; begin += grain)
+      run({ &batch, begin, min(begin + grain, count) });
+
+    if(batch.error)
+      rethrow_exception(batch.error);
+
+    return;
+  }
+
+  auto const queue = currentQueue();
+
+  {
+    auto& q = *m_queues[queue];
+    lock_guard<mutex> guard(q.lock);
+
+    for(int begin = 0; begin < count; begin += grain)
+      q.jobs.push_back({ &batch, begin, min(begin + grain, count) });
+  }
+
+  m_queuedJobs += numJobs;
+
+  {
+    // don't let a worker miss the wakeup between its check and its wait
+    lock_guard<mutex> guard(m_sleepLock);
+  }
+
+  m_wakeup.notify_all();
+
+  // help, until our own jobs are done
+  while(batch.pending > 0)
+  {
+    Job job;
+
+    if(popOwn(queue, &batch, job))
+    {
+      --m_queuedJobs;
+      run(job);
+    }
+    else
+    {
+      this_thread::yield();
+    }
+  }
+
+  if(batch.error)
+    rethrow_exception(batch.error);
+}
+
+// the most recent job of 'batch' in 'queue', or of any batch if 'batch' is null
+bool JobSystem::popOwn(int queue, const Batch* batch, Job& job)
+{
+  auto& q = *m_queues[queue];
+  lock_guard<mutex> guard(q.lock);
+
+  for(auto i = q.jobs.rbegin(); i != q.jobs.rend(); ++i)
+  {
+    if(batch && i->batch != batch)
+      continue;
+
+    job = *i;
+    q.jobs.erase(next(i).base());
+    return true;
+  }
+
+  return false;
+}
+
+bool JobSystem::steal(int thief, Job& job)
+{
+  auto const N = (int)m_queues.size();
+
+  for(int k = 1; k < N; ++k)
+  {
+    auto& q = *m_queues[(thief + k) % N];
+    lock_guard<mutex> guard(q.lock);
+
+    if(q.jobs.empty())
+      continue;
+
+    job = q.jobs.front();
+    q.jobs.pop_front();
+    return true;
+  }
+
+  return false;
+}
+
+bool JobSystem::runOneJob(int queue)
+{
+  Job job;
+
+  if(!popOwn(queue, nullptr, job) && !steal(queue, job))
+    return false;
+
+  --m_queuedJobs;
+  run(job);
+
+  return true;
+}
+
+void JobSystem::run(Job const& job)
+{
+  auto& batch = *job.batch;
+
+  try
+  {
+    (*batch.func)(job.begin, job.end);
+  }
+  catch(...)
+  {
+    lock_guard<mutex> guard(batch.errorLock);
+
+    if(!batch.error)
+      batch.error = current_exception();
+  }
+
+  // last access to the batch: its owner might return right after
+  --batch.pending;
+}
+
+void JobSystem::workerMain(int queue)
+{
+  t_system = this;
+  t_queue = queue;
+
+  while(true)
+  {
+    if(runOneJob(queue))
+      continue;
+
+    unique_lock<mutex> guard(m_sleepLock);
+    m_wakeup.wait(guard, [this] () { return m_quit || m_queuedJobs > 0; });
+
+    if(m_quit)
+      return;
+  }
+}
+
+int JobSystem::currentQueue() const
+{
+  return t_system == this ? t_queue : 0;
+}
+
+namespace
+{
+// no lazy creation: game instances on several threads might race for it
+unique_ptr<JobSystem> g_jobSystem = make_unique<JobSystem>(0);
+}
+
+JobSystem& getJobSystem()
+{
+  return *g_jobSystem;
+}
+
+void startJobSystem(int numWorkers)
+{
+  g_jobSystem = make_unique<JobSystem>(numWorkers);
+}
+
@@ -0,0 +1,90 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Work-stealing job system.
+// Each worker thread owns a queue of jobs: it pops jobs from the back
+// of its own queue, and steals from the front of the other queues
+// when its own is empty.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct JobSystem
+{
+  // with zero workers, everything runs on the calling thread
+  explicit JobSystem(int numWorkers);
+  ~JobSystem();
+
+  // Calls 'func(begin, end)' on chunks of at most 'grain' items covering
+  // [0;count[, and returns once all the chunks are done.
+  // The calling thread runs chunks too, but only the ones of this call.
+  // Can be called from several threads at once.
+  // If chunks throw, the first exception is rethrown, once all the
+  // chunks are done.
+  void parallelFor(int count, int grain, function<void(int begin, int end)> const& func);
+
+  int workerCount() const { return (int)m_threads.size(); }
+
+private:
+  // the chunks of one 'parallelFor' call
+  struct Batch
+  {
+    function<void(int, int)> const* func;
+    atomic<int> pending;
+    mutex errorLock;
+    exception_ptr error;
+  };
+
+  struct Job
+  {
+    Batch* batch;
+    int begin, end;
+  };
+
+  struct Queue
+  {
+    mutex lock;
+    deque<Job> jobs;
+  };
+
+  bool popOwn(int queue, const Batch* batch, Job& job);
+  bool steal(int thief, Job& job);
+  bool runOneJob(int queue);
+  static void run(Job const& job);
+  void workerMain(int queue);
+  int currentQueue() const;
+
+  // queue 0 receives the jobs of the threads that aren't workers,
+  // queue 'i' belongs to the worker 'i - 1'.
+  // Jobs are tagged with their batch: a thread waiting for its batch
+  // doesn't run the jobs another thread pushed to the same queue.
+  vector<unique_ptr<Queue>> m_queues;
+  vector<thread> m_threads;
+
+  atomic<int> m_queuedJobs;
+  mutex m_sleepLock;
+  condition_variable m_wakeup;
+  bool m_quit = false;
+};
+
+// Process-wide instance, used by the game.
+// Has no worker until 'startJobSystem' is called.
+JobSystem& getJobSystem();
+
+// call once, at startup, before any use of 'getJobSystem'
+void startJobSystem(int numWorkers);
+
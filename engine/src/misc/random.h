@@ -0,0 +1,19 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Reproducible random numbers: the same sequence on every platform,
+// so seeded runs (replays, tests, benchmarks) can be compared.
+
+#pragma once
+
+#include <cstdint>
+
+// in [0 .. 32767]
+inline int pseudoRandom(uint32_t& seed)
+{
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) & 0x7FFF;
+}
@@ -0,0 +1,200 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "replay.h"
+#include "file.h"
+
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+const char MAGIC[] = { 'E', 'R', 'E', 'C' };
+const int VERSION = 2;
+
+struct Writer
+{
+  string data;
+
+  void u8(int val)
+  {
+    data += (char)(val & 0xFF);
+  }
+
+  void u16(int val)
+  {
+    u8(val);
+    u8(val >> 8);
+  }
+
+  void u32(uint32_t val)
+  {
+    u16(val);
+    u16(val >> 16);
+  }
+};
+
+struct Reader
+{
+  string const& data;
+  size_t pos = 0;
+
+  int u8()
+  {
+    if(pos >= data.size())
+      throw runtime_error("Truncated replay file");
+
+    return (uint8_t)data[pos++];
+  }
+
+  int u16()
+  {
+    auto const lo = u8();
+    return lo | (u8() << 8);
+  }
+
+  uint32_t u32()
+  {
+    uint32_t const lo = u16();
+    return lo | (uint32_t(u16()) << 16);
+  }
+};
+}
+
+uint16_t encodeControl(Control c)
+{
+  uint16_t r = 0;
+  int bit = 0;
+
+  for(auto key : { c.left, c.right, c.up, c.down, c.start, c.fire, c.jump, c.dash, c.restart, c.debug })
+  {
+    if(key)
+      r |= 1 << bit;
+
+    ++bit;
+  }
+
+  return r;
+}
+
+Control decodeControl(uint16_t bits)
+{
+  Control r {};
+  int bit = 0;
+
+  for(auto key : { &r.left, &r.right, &r.up, &r.down, &r.start, &r.fire, &r.jump, &r.dash, &r.restart, &r.debug })
+    *key = (bits >> bit++) & 1;
+
+  return r;
+}
+
+void saveReplay(Replay const& replay, string path)
+{
+  Writer w;
+
+  for(auto c : MAGIC)
+    w.u8(c);
+
+  w.u8(VERSION);
+  w.u32(replay.seed);
+
+  w.u8(replay.args.size());
+
+  for(auto& arg : replay.args)
+  {
+    w.u16(arg.size());
+    w.data += arg;
+  }
+
+  w.u32(replay.ticks.size());
+
+  for(auto& tick : replay.ticks)
+  {
+    w.u16(encodeControl(tick.control));
+    w.u32(tick.checksum);
+  }
+
+  ofstream fp(path, ios::binary);
+
+  if(!fp.is_open())
+    throw runtime_error("Can't open file '" + path + "' for writing");
+
+  fp.write(w.data.data(), w.data.size());
+}
+
+Replay loadReplay(string path)
+{
+  auto const data = read(path);
+  Reader r { data };
+
+  for(auto c : MAGIC)
+    if(r.u8() != c)
+      throw runtime_error("'" + path + "' is not a replay file");
+
+  if(r.u8() != VERSION)
+    throw runtime_error("Unsupported replay file version");
+
+  Replay replay;
+  replay.seed = r.u32();
+
+  auto const argCount = r.u8();
+
+  for(int i = 0; i < argCount; ++i)
+  {
+    auto const len = r.u16();
+    string arg;
+
+    for(int k = 0; k < len; ++k)
+      arg += (char)r.u8();
+
+    replay.args.push_back(arg);
+  }
+
+  auto const tickCount = r.u32();
+
+  for(uint32_t i = 0; i < tickCount; ++i)
+  {
+    Replay::Tick tick;
+    tick.control = decodeControl(r.u16());
+    tick.checksum = r.u32();
+    replay.ticks.push_back(tick);
+  }
+
+  return replay;
+}
+
+void FrameHash::add(Actor const& actor)
+{
+  add(&actor.pos.x, sizeof actor.pos.x);
+  add(&actor.pos.y, sizeof actor.pos.y);
+  add(&actor.model, sizeof actor.model);
+  add(&actor.action, sizeof actor.action);
+
+  // The drawing code computes the animation ratios from the state, with
+  // divisions: builds allowed to turn them into multiplications by the
+  // inverse (e.g -ffast-math) can get another last bit: only hash what shows.
+  auto const ratio = (int)floor(actor.ratio * 4096 + 0.5f);
+  add(&ratio, sizeof ratio);
+
+  add(&actor.scale.width, sizeof actor.scale.width);
+  add(&actor.scale.height, sizeof actor.scale.height);
+  add(&actor.effect, sizeof actor.effect);
+  add(&actor.screenRefFrame, sizeof actor.screenRefFrame);
+  add(&actor.zOrder, sizeof actor.zOrder);
+}
+
+void FrameHash::add(const void* data, size_t len)
+{
+  auto bytes = (const uint8_t*)data;
+
+  for(size_t i = 0; i < len; ++i)
+  {
+    value ^= bytes[i];
+    value *= 16777619u;
+  }
+}
+
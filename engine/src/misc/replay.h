@@ -0,0 +1,52 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Recorded game session: everything needed to reproduce a run tick by tick.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/scene.h"
+#include "base/view.h"
+
+using namespace std;
+
+struct Replay
+{
+  struct Tick
+  {
+    Control control;
+    uint32_t checksum; // of the state after the tick (see FrameHash)
+  };
+
+  uint32_t seed = 0; // passed to 'srand' before creating the game
+  vector<string> args; // passed to 'createGame'
+  vector<Tick> ticks;
+};
+
+// compact binary format: a header, then 6 bytes per tick
+void saveReplay(Replay const& replay, string path);
+Replay loadReplay(string path);
+
+uint16_t encodeControl(Control c);
+Control decodeControl(uint16_t bits);
+
+// Checksum of a frame, as sent to the view by 'Scene::draw'.
+// Used as a state checksum: the positions, sprites and animations
+// of every entity end up there.
+struct FrameHash
+{
+  uint32_t value = 2166136261u; // FNV-1a
+
+  void add(Actor const& actor);
+
+private:
+  void add(const void* data, size_t len);
+};
+
@@ -0,0 +1,148 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/src/misc/jobs.h"
+#include "tests.h"
+#include <stdexcept>
+#include <string>
+#include <vector>
+using namespace std;
+
+static
+void checkParallelFor(JobSystem& jobs, int count, int grain)
+{
+  vector<atomic<int>> calls(count);
+
+  for(auto& c : calls)
+    c = 0;
+
+  jobs.parallelFor(count, grain, [&] (int begin, int end)
+    {
+      assert(end - begin <= grain);
+
+      for(int i = begin; i < end; ++i)
+        calls[i]++;
+    });
+
+  for(auto& c : calls)
+    assertEquals(1, c.load());
+}
+
+unittest("Jobs: every item is processed exactly once")
+{
+  JobSystem noWorkers(0);
+  JobSystem jobs(3);
+
+  for(auto count : { 0, 1, 7, 64, 1000 })
+  {
+    for(auto grain : { 1, 5, 64 })
+    {
+      checkParallelFor(noWorkers, count, grain);
+      checkParallelFor(jobs, count, grain);
+    }
+  }
+}
+
+unittest("Jobs: several threads submitting at once")
+{
+  JobSystem jobs(2);
+
+  vector<thread> submitters;
+
+  for(int k = 0; k < 4; ++k)
+    submitters.push_back(thread([&] ()
+      {
+        for(int i = 0; i < 50; ++i)
+          checkParallelFor(jobs, 100, 3);
+      }));
+
+  for(auto& t : submitters)
+    t.join();
+}
+
+
+unittest("Jobs: a waiting caller only runs its own chunks")
+{
+  // no worker would pick the jobs up: the callers do everything
+  JobSystem jobs(1);
+
+  auto const numCallers = 4;
+  vector<thread::id> callers(numCallers);
+  vector<vector<thread::id>> runners(numCallers, vector<thread::id>(200));
+
+  // all the callers submit at the same time
+  atomic<int> ready(0);
+
+  vector<thread> submitters;
+
+  for(int k = 0; k < numCallers; ++k)
+    submitters.push_back(thread([&, k] ()
+      {
+        callers[k] = this_thread::get_id();
+
+        for(++ready; ready < numCallers;)
+          this_thread::yield();
+
+        for(int i = 0; i < 50; ++i)
+        {
+          jobs.parallelFor(200, 2, [&] (int begin, int end)
+            {
+              for(int item = begin; item < end; ++item)
+                runners[k][item] = this_thread::get_id();
+
+              // let the other callers push their chunks meanwhile
+              this_thread::yield();
+            });
+        }
+      }));
+
+  for(auto& t : submitters)
+    t.join();
+
+  for(int k = 0; k < numCallers; ++k)
+  {
+    for(auto runner : runners[k])
+    {
+      for(int other = 0; other < numCallers; ++other)
+        assert(other == k || runner != callers[other]);
+    }
+  }
+}
+
+unittest("Jobs: exceptions are rethrown by parallelFor")
+{
+  for(auto numWorkers : { 0, 3 })
+  {
+    JobSystem jobs(numWorkers);
+    atomic<int> processed(0);
+
+    bool thrown = false;
+
+    try
+    {
+      jobs.parallelFor(100, 4, [&] (int begin, int end)
+        {
+          processed += end - begin;
+
+          if(begin == 40)
+            throw runtime_error("chunk failed");
+        });
+    }
+    catch(runtime_error const& e)
+    {
+      thrown = true;
+      assertEquals(string("chunk failed"), string(e.what()));
+    }
+
+    assert(thrown);
+
+    // the other chunks were still run
+    assertEquals(100, processed.load());
+
+    // still usable
+    checkParallelFor(jobs, 100, 4);
+  }
+}
@@ -0,0 +1,83 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/src/misc/replay.h"
+#include "tests.h"
+#include <cmath> // nextafter
+#include <cstdio> // remove
+using namespace std;
+
+unittest("Replay: control encoding")
+{
+  for(int bits = 0; bits < 1024; ++bits)
+    assertEquals(bits, encodeControl(decodeControl(bits)));
+
+  Control c {};
+  c.right = true;
+  c.jump = true;
+  assertEquals(0x42, encodeControl(c));
+}
+
+unittest("Replay: save then load")
+{
+  Replay replay;
+  replay.seed = 0xDEADBEEF;
+  replay.args = { "3", "" };
+
+  for(int i = 0; i < 1000; ++i)
+    replay.ticks.push_back({ decodeControl(i % 1024), uint32_t(i * 2654435761u) });
+
+  auto const path = "replay_test.rec";
+  saveReplay(replay, path);
+  auto const loaded = loadReplay(path);
+  remove(path);
+
+  assertEquals(replay.seed, loaded.seed);
+  assertEquals(replay.args, loaded.args);
+  assertEquals((int)replay.ticks.size(), (int)loaded.ticks.size());
+
+  for(int i = 0; i < (int)replay.ticks.size(); ++i)
+  {
+    assertEquals(encodeControl(replay.ticks[i].control), encodeControl(loaded.ticks[i].control));
+    assertEquals(replay.ticks[i].checksum, loaded.ticks[i].checksum);
+  }
+}
+
+unittest("Replay: frame hash depends on the actors")
+{
+  Actor a;
+  Actor b = a;
+  b.pos.x += 1.0 / 1024;
+
+  FrameHash hashA, hashB, hashA2;
+  hashA.add(a);
+  hashA2.add(a);
+  hashB.add(b);
+
+  assertEquals(hashA.value, hashA2.value);
+  assert(hashA.value != hashB.value);
+}
+
+
+unittest("Replay: frame hash ignores the last bit of animation ratios")
+{
+  Actor a;
+  a.ratio = 8 / 80.0f;
+
+  Actor b = a;
+  b.ratio = nextafter(a.ratio, 0.0f);
+
+  Actor c = a;
+  c.ratio = 9 / 80.0f;
+
+  FrameHash hashA, hashB, hashC;
+  hashA.add(a);
+  hashB.add(b);
+  hashC.add(c);
+
+  assertEquals(hashA.value, hashB.value);
+  assert(hashA.value != hashC.value);
+}
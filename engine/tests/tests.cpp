@@ -24,6 +24,9 @@ int const MAX_TESTS = 512;
 
 Test tests[MAX_TESTS];
 int numTests;
+
+Test benchmarks[MAX_TESTS];
+int numBenchmarks;
 }
 
 int RegisterTest(void (* proc)(), const char* testName)
@@ -49,3 +52,26 @@ void RunTests(const char* filter)
   }
 }
 
+
+int RegisterBenchmark(void (* proc)(), const char* benchName)
+{
+  assert(numBenchmarks < MAX_TESTS);
+  benchmarks[numBenchmarks].run = proc;
+  benchmarks[numBenchmarks].sName = benchName;
+  ++numBenchmarks;
+  return 1;
+}
+
+void RunBenchmarks(const char* filter)
+{
+  printf("Running benchmarks.\n");
+
+  for(int i = 0; i < numBenchmarks; ++i)
+  {
+    if(!strstr(benchmarks[i].sName, filter))
+      continue;
+
+    printf("[%d] %s\n", i, benchmarks[i].sName);
+    benchmarks[i].run();
+  }
+}
@@ -16,6 +16,10 @@
 int RegisterTest(void (* f)(), const char* testName);
 void RunTests(const char* filter);
 
+// benchmarks are only run on demand (see tests_main.cpp)
+int RegisterBenchmark(void (* f)(), const char* benchName);
+void RunBenchmarks(const char* filter);
+
 struct Registrator
 {
   Registrator(void(*f)(), char const* name)
@@ -35,6 +39,25 @@ struct Registrator
   static Registrator g_Registrator ## line( & prefix ## line, name); \
   static void prefix ## line()
 
+struct BenchmarkRegistrator
+{
+  BenchmarkRegistrator(void(*f)(), char const* name)
+  {
+    RegisterBenchmark(f, name);
+  }
+};
+
+#define benchmark(name) \
+  benchmark2(__LINE__, name)
+
+#define benchmark2(line, name) \
+  benchmark3(benchFunction, line, name)
+
+#define benchmark3(prefix, line, name) \
+  static void prefix ## line(); \
+  static BenchmarkRegistrator g_BenchmarkRegistrator ## line( & prefix ## line, name); \
+  static void prefix ## line()
+
 #define assertEquals(u, v) \
   assertEqualsFunc(u, v, __FILE__, __LINE__)
 
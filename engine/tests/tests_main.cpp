@@ -7,6 +7,7 @@
 // Unit test framework: entry point
 
 #include <cstdio>
+#include <cstring>
 #include "tests.h"
 
 using namespace std;
@@ -14,13 +15,25 @@ using namespace std;
 int main(int argc, char* argv[])
 {
   char const* filter = "";
+  bool benchmarks = false;
+
+  if(argc >= 2 && strcmp(argv[1], "--benchmark") == 0)
+  {
+    benchmarks = true;
+    ++argv;
+    --argc;
+  }
 
   if(argc == 2)
     filter = argv[1];
 
   try
   {
-    RunTests(filter);
+    if(benchmarks)
+      RunBenchmarks(filter);
+    else
+      RunTests(filter);
+
     return 0;
   }
   catch(std::exception const& e)
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+# Records a game with the headless runner, then replays it with several
+# job system sizes. The replay compares the state checksum of every tick
+# (see FrameHash) and fails at the first divergence.
+# The replays can be run by another build of the runner (e.g other
+# compiler flags), which then must simulate exactly like the first one.
+#
+# usage: scripts/check-determinism.sh <headless.exe> [replaying-headless.exe]
+# (from the directory containing 'res')
+set -euo pipefail
+
+readonly headless=$1
+readonly replayer=${2:-$1}
+
+readonly tmpDir=/tmp/deeep-det-$$
+trap "rm -rf $tmpDir" EXIT
+mkdir -p $tmpDir
+
+cat > $tmpDir/script.txt <<SCRIPT
+60 right
+10 right jump
+40 left fire
+5 jump
+30 dash right
+52 jump
+82 down fire
+75 dash
+65 right
+86 dash jump
+116 right
+43 left up
+65 dash
+59 down fire
+61 fire
+SCRIPT
+
+for level in 1 3 4 6 8 ; do
+  $headless --jobs 0 --level $level --ticks 6000 --script $tmpDir/script.txt --record $tmpDir/level-$level.rec >/dev/null
+
+  for jobs in 0 1 4 ; do
+    $replayer --jobs $jobs --replay $tmpDir/level-$level.rec >/dev/null
+  done
+done
@@ -0,0 +1,251 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Physics micro-benchmarks, on synthetic rooms.
+// Prints one JSON object per line, e.g:
+// {"scenario":"walkers","bodies":64,"ticks":1000,"moveBody_ns":110.2,"checkForOverlaps_ns":2104.5,"tick_ns":16310.8}
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib> // atoi
+#include <vector>
+
+#include "collision_groups.h"
+#include "engine/src/misc/clock.h"
+#include "engine/src/misc/random.h"
+#include "load_quest.h" // generateConcreteRoom
+#include "physics.h"
+
+using namespace std;
+
+namespace
+{
+struct Random
+{
+  uint32_t seed = 1234;
+
+  int operator () (int max)
+  {
+    return pseudoRandom(seed) % max;
+  }
+};
+
+struct Mover : Body
+{
+  Vector vel;
+  float phase = 0; // pushers only
+};
+
+struct World
+{
+  unique_ptr<IPhysics> physics = createPhysics();
+  SolidityMap tiles;
+  Size2i size;
+  vector<Mover> bodies;
+  int moveCount = 0;
+};
+
+void createRoom(World& world, int numBodies)
+{
+  Room room;
+  room.size = Size2i(max(1, numBodies / 32), 2);
+  generateConcreteRoom(room);
+
+  world.size = room.tiles.size;
+  world.tiles = SolidityMap(room.tiles);
+  world.physics->setEdifice(world.tiles);
+
+  // no reallocation: the physics keeps pointers to the bodies
+  world.bodies.reserve(numBodies);
+}
+
+// places 'body' somewhere free, or returns false.
+// 'clearance' is the free space required around the body.
+bool place(World& world, Mover& body, Random& rnd, Box clearance = Box(0, 0, 0, 0))
+{
+  for(int attempt = 0; attempt < 1000; ++attempt)
+  {
+    body.pos.x = rnd(world.size.width * 10) * 0.1;
+    body.pos.y = rnd(world.size.height * 10) * 0.1;
+
+    auto area = body.getFBox();
+    area.pos += clearance.pos;
+    area.size.width += clearance.size.width;
+    area.size.height += clearance.size.height;
+
+    auto const box = roundBox(area);
+
+    if(!world.tiles.isBoxSolid(box) && !world.physics->getBodiesInBox(box, CG_ALL))
+      return true;
+  }
+
+  return false;
+}
+
+Mover* addBody(World& world, Mover body)
+{
+  world.bodies.push_back(body);
+  auto r = &world.bodies.back();
+  world.physics->addBody(r);
+  return r;
+}
+
+// enemies walking around, and a few players
+void createWalkers(World& world, int numBodies)
+{
+  Random rnd;
+
+  for(int i = 0; i < numBodies; ++i)
+  {
+    Mover body;
+    body.size = Size(0.8, 1.5);
+    body.vel = Vector(rnd(2) ? 0.01 : -0.01, 0);
+
+    if(i % 8 == 0)
+    {
+      body.collisionGroup = CG_PLAYER | CG_SOLIDPLAYER;
+      body.collidesWith = CG_WALLS | CG_DOORS | CG_BONUS;
+    }
+    else
+    {
+      body.collisionGroup = CG_WALLS;
+      body.collidesWith = CG_SOLIDPLAYER;
+    }
+
+    if(place(world, body, rnd))
+      addBody(world, body);
+  }
+}
+
+// moving platforms, each one carrying a stack of three crates
+void createPushers(World& world, int numBodies)
+{
+  Random rnd;
+
+  for(int i = 0; i + 4 <= numBodies; i += 4)
+  {
+    Mover platform;
+    platform.size = Size(2, 0.5);
+    platform.solid = true;
+    platform.pusher = true;
+    platform.collisionGroup = CG_WALLS;
+    platform.collidesWith = 0;
+    platform.phase = rnd(100) * 0.1;
+
+    // keep clear of the other platforms' travel and stacks:
+    // two pushers meeting would push each other forever.
+    if(!place(world, platform, rnd, Box(-1, -2, 2, 6)))
+      continue;
+
+    auto const base = platform.pos;
+    addBody(world, platform);
+
+    for(int k = 0; k < 3; ++k)
+    {
+      Mover crate;
+      crate.size = Size(0.8, 0.8);
+      crate.solid = true;
+      crate.collisionGroup = CG_WALLS;
+      crate.collidesWith = CG_WALLS;
+      crate.pos = base + Vector(0.6, 0.5 + k * 0.8);
+
+      auto const box = crate.getBox();
+
+      if(world.tiles.isBoxSolid(box) || world.physics->getBodiesInBox(box, CG_ALL))
+        break;
+
+      addBody(world, crate);
+    }
+  }
+}
+
+void tick(World& world, int tickCount)
+{
+  for(auto& body : world.bodies)
+  {
+    auto const physics = world.physics.get();
+
+    if(body.pusher)
+    {
+      auto const delta = 0.02 * sin(tickCount * 0.02 + body.phase);
+      physics->moveBody(&body, Vector(0, delta));
+      world.moveCount++;
+      continue;
+    }
+
+    // gravity
+    body.vel.y = max(body.vel.y - 0.0005f, -0.02f);
+
+    if(!physics->moveBody(&body, Vector(body.vel.x, 0)))
+      body.vel.x = -body.vel.x;
+
+    if(!physics->moveBody(&body, Vector(0, body.vel.y)))
+      body.vel.y = 0;
+
+    world.moveCount += 2;
+  }
+}
+
+void run(const char* scenario, void (* populate)(World &, int), int numBodies, int numTicks)
+{
+  World world;
+  createRoom(world, numBodies);
+  populate(world, numBodies);
+
+  // let the bodies settle
+  for(int i = 0; i < 10; ++i)
+  {
+    tick(world, i);
+    world.physics->checkForOverlaps();
+  }
+
+  world.moveCount = 0;
+
+  double moveTime = 0;
+  double overlapsTime = 0;
+
+  for(int i = 0; i < numTicks; ++i)
+  {
+    auto const t0 = now();
+    tick(world, 10 + i);
+    auto const t1 = now();
+    world.physics->checkForOverlaps();
+    auto const t2 = now();
+
+    moveTime += t1 - t0;
+    overlapsTime += t2 - t1;
+  }
+
+  printf("{\"scenario\":\"%s\",\"bodies\":%d,\"ticks\":%d,\"moveBody_ns\":%.1f,\"checkForOverlaps_ns\":%.1f,\"tick_ns\":%.1f}\n",
+         scenario,
+         (int)world.bodies.size(),
+         numTicks,
+         moveTime * 1e9 / max(1, world.moveCount),
+         overlapsTime * 1e9 / numTicks,
+         (moveTime + overlapsTime) * 1e9 / numTicks);
+  fflush(stdout);
+}
+}
+
+int main(int argc, const char* argv[])
+{
+  auto const numTicks = argc > 1 ? atoi(argv[1]) : 1000;
+
+  if(argc > 2 || numTicks <= 0)
+  {
+    fprintf(stderr, "Usage: %s [ticks]\n", argv[0]);
+    return 1;
+  }
+
+  for(auto n : { 16, 64, 256, 1024 })
+  {
+    run("walkers", &createWalkers, n, numTicks);
+    run("pushers", &createPushers, n, numTicks);
+  }
+
+  return 0;
+}
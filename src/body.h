@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include "vec.h"
 
@@ -16,6 +17,25 @@ using namespace std;
 
 IntBox roundBox(Box b);
 
+// Refers to a body of a physics world, across frames.
+// Stays safe to use once the body is removed from the world
+// (or destroyed): it then resolves to null (see IPhysicsProbe::resolve).
+struct BodyHandle
+{
+  int index = -1; // stable, unlike 'Body::slot'
+  uint32_t generation = 0;
+
+  bool operator == (BodyHandle other) const
+  {
+    return index == other.index && generation == other.generation;
+  }
+
+  bool operator != (BodyHandle other) const
+  {
+    return !(*this == other);
+  }
+};
+
 struct Body
 {
   // make type polymorphic
@@ -32,8 +52,11 @@ struct Body
   int collisionGroup = 1;
   int collidesWith = 0xFFFF;
 
-  // the body we rest on (if any)
-  Body* floor = nullptr;
+  // the body we rest on (if any), managed by the physics
+  BodyHandle floor;
+
+  // index inside the physics world (managed by the physics)
+  int slot = -1;
 
   // only called if (this->collidesWith & other->collisionGroup)
   function<void(Body*)> onCollision = [] (Body*) {};
@@ -0,0 +1,112 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Dense structure-of-arrays mirror of the collision state of the bodies,
+// indexed by body slot (see Body::slot).
+// Queries stream through contiguous integer boxes and filter flags,
+// instead of dereferencing each body and rounding its float position.
+//
+// A slot is refreshed when its body goes through 'moveBody', 'sweepBody'
+// or 'syncBody', and every slot is refreshed at the start of
+// 'checkForOverlaps'. In between, a body whose fields were written
+// directly is still seen as it was (see IPhysicsProbe::syncBody).
+// 'pusher' isn't mirrored: it's only read on the body being moved.
+
+#pragma once
+
+#include <algorithm> // min, max
+#include <climits>
+#include <cstdint>
+#include <vector>
+#include "body.h"
+
+using namespace std;
+
+struct BodyStore
+{
+  vector<Body*> handles;
+
+  // integer bounding boxes, in PRECISION units: [x1;x2[ x [y1;y2[
+  vector<int> x1, y1, x2, y2;
+
+  vector<int> groups; // Body::collisionGroup
+  vector<int> masks; // Body::collidesWith
+  vector<uint8_t> solid; // Body::solid
+
+  // contains every box the store ever held (only grows)
+  int minX = INT_MAX, minY = INT_MAX;
+  int maxX = INT_MIN, maxY = INT_MIN;
+
+  int size() const { return (int)handles.size(); }
+
+  IntBox box(int i) const
+  {
+    return IntBox(x1[i], y1[i], x2[i] - x1[i], y2[i] - y1[i]);
+  }
+
+  void push(Body* body)
+  {
+    handles.push_back(body);
+    x1.push_back(0);
+    y1.push_back(0);
+    x2.push_back(0);
+    y2.push_back(0);
+    groups.push_back(0);
+    masks.push_back(0);
+    solid.push_back(0);
+    sync(size() - 1);
+  }
+
+  void pop()
+  {
+    handles.pop_back();
+    x1.pop_back();
+    y1.pop_back();
+    x2.pop_back();
+    y2.pop_back();
+    groups.pop_back();
+    masks.pop_back();
+    solid.pop_back();
+  }
+
+  void copy(int dst, int src)
+  {
+    handles[dst] = handles[src];
+    x1[dst] = x1[src];
+    y1[dst] = y1[src];
+    x2[dst] = x2[src];
+    y2[dst] = y2[src];
+    groups[dst] = groups[src];
+    masks[dst] = masks[src];
+    solid[dst] = solid[src];
+  }
+
+  // refresh the mirror from the body.
+  // Returns true if the box or the collision masks changed.
+  bool sync(int i)
+  {
+    auto const body = handles[i];
+    auto const rect = body->getBox();
+    auto const old = box(i);
+    auto const changed = rect.pos.x != old.pos.x || rect.pos.y != old.pos.y || rect.size != old.size
+      || body->collisionGroup != groups[i] || body->collidesWith != masks[i];
+
+    x1[i] = rect.pos.x;
+    y1[i] = rect.pos.y;
+    x2[i] = rect.pos.x + rect.size.width;
+    y2[i] = rect.pos.y + rect.size.height;
+    groups[i] = body->collisionGroup;
+    masks[i] = body->collidesWith;
+    solid[i] = body->solid;
+
+    minX = min(minX, x1[i]);
+    minY = min(minY, y1[i]);
+    maxX = max(maxX, x2[i]);
+    maxY = max(maxY, y2[i]);
+
+    return changed;
+  }
+};
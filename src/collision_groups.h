@@ -10,7 +10,6 @@ static auto const CG_ALL = -1;
 static auto const CG_PLAYER = 0x1;
 static auto const CG_SOLIDPLAYER = 0x2; // non-blinking player
 static auto const CG_WALLS = 0x4;
-static auto const CG_LADDER = 0x8;
 static auto const CG_DOORS = 0x10;
 static auto const CG_BONUS = 0x20;
 
@@ -48,17 +48,25 @@ struct FragileBlock : Entity, Damageable
     disappear();
   }
 
+  void prepare() override
+  {
+    // the timer only runs while disappearing or disappeared
+    if(state != 0)
+      timerExpired = decrement(timer);
+  }
+
   void tick() override
   {
     bool canReapear = !physics->getBodiesInBox(getBox(), CG_PLAYER, false, this);
 
     if(state == 1)
     {
-      if(decrement(timer))
+      if(timerExpired)
       {
         collisionGroup = 0;
         collidesWith = 0;
         solid = 0;
+        physics->syncBody(this);
 
         state = 2;
         timer = 300;
@@ -66,10 +74,11 @@ struct FragileBlock : Entity, Damageable
     }
     else if(state == 2)
     {
-      decrement(timer);
-
       if(canReapear && timer == 0)
+      {
         reappear();
+        physics->syncBody(this);
+      }
     }
     else if(state == 0)
     {
@@ -94,6 +103,7 @@ struct FragileBlock : Entity, Damageable
 
   int state = 0; // 0: solid, 1:disapearing, 2: disapeared
   int timer = 0;
+  bool timerExpired = false;
 };
 
 #include "entity_factory.h"
@@ -15,11 +15,11 @@
 
 struct RoomBoundaryDetector : Entity
 {
-  RoomBoundaryDetector(int targetLevel_, Vector transform_)
+  RoomBoundaryDetector(int targetLevel_, Vector transform_, Size size_)
   {
     targetLevel = targetLevel_;
     transform = transform_;
-    size = UnitSize * 16;
+    size = size_;
     solid = false;
     collisionGroup = 0;
     collidesWith = CG_PLAYER | CG_SOLIDPLAYER;
@@ -33,12 +33,17 @@ struct RoomBoundaryDetector : Entity
     actors.push_back(r);
   }
 
+  void resume() override
+  {
+    touched = false;
+  }
+
   void onCollide(Body*)
   {
     if(touched)
       return;
 
-    game->postEvent(make_unique<TouchLevelBoundary>(targetLevel, transform));
+    game->postEvent(TouchLevelBoundary(targetLevel, transform));
     touched = true;
   }
 
@@ -49,9 +54,9 @@ struct RoomBoundaryDetector : Entity
 
 struct RoomBoundaryBlocker : Entity
 {
-  RoomBoundaryBlocker(int groupsToBlock)
+  RoomBoundaryBlocker(int groupsToBlock, Size size_)
   {
-    size = UnitSize * 16;
+    size = size_;
     solid = true;
     collisionGroup = CG_WALLS;
     collidesWith = groupsToBlock;
@@ -68,13 +73,20 @@ struct RoomBoundaryBlocker : Entity
 
 #include "entity_factory.h"
 
+// one room cell by default.
+// Both entities have "width" and "height" as first parameters.
+static Size getBoundarySize(IEntityConfig* cfg)
+{
+  return Size(cfg->getInt(0, 16), cfg->getInt(1, 16));
+}
+
 static unique_ptr<Entity> makeBoundaryDetector(IEntityConfig* cfg)
 {
-  auto targetLevel = cfg->getInt("0");
-  auto transform = Vector(cfg->getInt("1"), cfg->getInt("2"));
-  return make_unique<RoomBoundaryDetector>(targetLevel, transform);
+  auto targetLevel = cfg->getInt(2);
+  auto transform = Vector(cfg->getInt(3), cfg->getInt(4));
+  return make_unique<RoomBoundaryDetector>(targetLevel, transform, getBoundarySize(cfg));
 }
 
-static auto const reg1 = registerEntity("room_boundary_detector", &makeBoundaryDetector);
-static auto const reg2 = registerEntity("blocker", [] (IEntityConfig*) -> unique_ptr<Entity> { return make_unique<RoomBoundaryBlocker>(-1); });
+static auto const reg1 = registerEntity("room_boundary_detector", &makeBoundaryDetector, { "width", "height", "0", "1", "2" });
+static auto const reg2 = registerEntity("blocker", [] (IEntityConfig* cfg) -> unique_ptr<Entity> { return make_unique<RoomBoundaryBlocker>(-1, getBoundarySize(cfg)); }, { "width", "height" });
 
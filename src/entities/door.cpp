@@ -30,7 +30,10 @@ struct Door : Entity
 
         // in case of closing, immediately prevent traversal
         if(!open)
+        {
           solid = true;
+          physics->syncBody(this);
+        }
 
         game->playSound(SND_DOOR);
       };
@@ -55,7 +58,10 @@ struct Door : Entity
     decrement(delay);
 
     if(delay == 0 && state)
+    {
       solid = false;
+      physics->syncBody(this);
+    }
   }
 
   virtual void addActors(vector<Actor>& actors) const override
@@ -138,5 +144,5 @@ struct BreakableDoor : Entity, Damageable
 
 #include "entity_factory.h"
 static auto const reg1 = registerEntity("fragile_door", [] (IEntityConfig*) -> unique_ptr<Entity> { return make_unique<BreakableDoor>(); });
-static auto const reg2 = registerEntity("door", [] (IEntityConfig* args) -> unique_ptr<Entity> { auto arg = args->getInt("0"); return makeDoor(arg); });
+static auto const reg2 = registerEntity("door", [] (IEntityConfig* args) -> unique_ptr<Entity> { auto arg = args->getInt(0); return makeDoor(arg); }, { "0" });
 
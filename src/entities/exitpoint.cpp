@@ -63,7 +63,7 @@ struct ExitPoint : Entity
 
     if(decrement(timer))
     {
-      game->postEvent(make_unique<FinishGameEvent>());
+      game->postEvent(FinishGameEvent());
       active = true;
     }
   }
@@ -23,7 +23,7 @@ struct Explosion : Entity
     size = UnitSize * 0.1;
   }
 
-  virtual void tick() override
+  virtual void prepare() override
   {
     time++;
 
@@ -42,10 +42,13 @@ struct Hatch : Entity
     }
   }
 
-  void tick() override
+  void prepare() override
   {
     decrement(openingTimer);
+  }
 
+  void tick() override
+  {
     if(openingTimer > 0)
     {
       collidesWith = 0;
@@ -58,6 +61,8 @@ struct Hatch : Entity
       collidesWith = CG_PLAYER;
       solid = 1;
     }
+
+    physics->syncBody(this);
   }
 
   int openingTimer = 0;
@@ -15,8 +15,6 @@
 #include "collision_groups.h"
 #include "toggle.h" // decrement
 
-#include <cstdlib> // rand
-
 struct Hopper : Entity, Damageable
 {
   Hopper()
@@ -54,7 +52,7 @@ struct Hopper : Entity, Damageable
 
     vel.y -= 0.005; // gravity
 
-    if(ground && time % 50 == 0 && rand() % 4 == 0)
+    if(ground && time % 50 == 0 && game->random() % 4 == 0)
     {
       vel.y = 0.13;
       ground = false;
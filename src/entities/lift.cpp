@@ -37,9 +37,10 @@ struct Lift : Entity
     solid = true;
     pusher = true;
     size = Size(2, 1);
-    link = cfg->getInt("link", 0);
-    delta_x = cfg->getInt("delta_x", 0);
-    delta_y = cfg->getInt("delta_y", +7);
+    // see the registration below
+    link = cfg->getInt(0, 0);
+    delta_x = cfg->getInt(1, 0);
+    delta_y = cfg->getInt(2, +7);
     collisionGroup = CG_DOORS;
   }
 
@@ -175,5 +176,5 @@ struct Lift : Entity
 };
 }
 
-static auto const reg = registerEntity("lift", [] (IEntityConfig* cfg) -> unique_ptr<Entity> { return make_unique<Lift>(cfg); });
+static auto const reg = registerEntity("lift", [] (IEntityConfig* cfg) -> unique_ptr<Entity> { return make_unique<Lift>(cfg); }, { "link", "delta_x", "delta_y" });
 
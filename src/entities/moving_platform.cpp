@@ -25,10 +25,14 @@ struct MovingPlatform : Entity
     pusher = true;
     size = Size(2, 1);
     collisionGroup = CG_WALLS;
-    ticks = rand();
     dir = dir_;
   }
 
+  void enter() override
+  {
+    ticks = game->random();
+  }
+
   virtual void addActors(vector<Actor>& actors) const override
   {
     auto r = Actor { pos, MDL_RECT };
@@ -37,7 +41,7 @@ struct MovingPlatform : Entity
     actors.push_back(r);
   }
 
-  void tick() override
+  void prepare() override
   {
     auto delta = 0.05 * sin(ticks * 0.05) * speed;
 
@@ -45,11 +49,16 @@ struct MovingPlatform : Entity
     if(abs(delta) < 0.001)
       delta = 0;
 
-    auto v = dir ? Vector(delta, 0) : Vector(0, delta);
-    physics->moveBody(this, v);
+    motion = dir ? Vector(delta, 0) : Vector(0, delta);
     ++ticks;
   }
 
+  void tick() override
+  {
+    physics->moveBody(this, motion);
+  }
+
+  Vector motion; // computed by prepare
   int ticks = 0;
   int dir = 0;
   float speed = 1.0;
@@ -154,6 +163,6 @@ struct Elevator : Entity
 
 #include "entity_factory.h"
 
-static auto const reg1 = registerEntity("moving_platform", [] (IEntityConfig* cfg)  -> unique_ptr<Entity> { auto arg = cfg->getInt("dir"); auto speed = cfg->getInt("speed", 100); return make_unique<MovingPlatform>(arg, speed); });
+static auto const reg1 = registerEntity("moving_platform", [] (IEntityConfig* cfg)  -> unique_ptr<Entity> { auto arg = cfg->getInt(0); auto speed = cfg->getInt(1, 100); return make_unique<MovingPlatform>(arg, speed); }, { "dir", "speed" });
 static auto const reg2 = registerEntity("elevator", [] (IEntityConfig*)  -> unique_ptr<Entity> { return make_unique<Elevator>(); });
 
@@ -56,15 +56,19 @@ struct WhipHit : Entity
     }
   }
 
-  void tick() override
+  void prepare() override
   {
-    pos += vel;
     decrement(life);
 
     if(life == 0)
       dead = true;
   }
 
+  void tick() override
+  {
+    pos += vel;
+  }
+
   void onCollide(Body* other)
   {
     if(auto damageable = dynamic_cast<Damageable*>(other))
@@ -84,8 +88,7 @@ struct Rockman : Player, Damageable, Resurrectable
   Rockman()
   {
     size = NORMAL_SIZE;
-    collidesWith = CG_WALLS | CG_LADDER;
-    Body::onCollision = [this] (Body* other) { onCollide(other); };
+    collidesWith = CG_WALLS;
   }
 
   void resurrect() override
@@ -96,15 +99,6 @@ struct Rockman : Player, Damageable, Resurrectable
     resurrectDelay = 100;
   }
 
-  void onCollide(Body* b)
-  {
-    if(dynamic_cast<Climbable*>(b))
-    {
-      ladderDelay = 10;
-      ladderX = b->pos.x;
-    }
-  }
-
   virtual void addActors(vector<Actor>& actors) const override
   {
     auto r = Actor { pos, MDL_ROCKMAN };
@@ -382,6 +376,51 @@ struct Rockman : Player, Damageable, Resurrectable
 
     for(int i = 0; i < 10; ++i)
       subTick();
+
+    detectLadder();
+  }
+
+  void detectLadder()
+  {
+    // the ladder must be overlapped, not only touched
+    auto box = getBox();
+    box.size.width -= 1;
+    box.size.height -= 1;
+
+    Vector2i cell;
+
+    if(physics->findTile(box, TILE_CLIMBABLE, &cell))
+    {
+      ladderDelay = 10;
+      ladderX = cell.x;
+    }
+  }
+
+  // Hazards hurt on contact. They're solid: the player is either
+  // blocked by one, or touching one (e.g pushed there by a platform).
+  void checkHazards(Trace trace)
+  {
+    if(!(collisionGroup & CG_SOLIDPLAYER))
+      return;
+
+    auto bumps = [&] (Vector delta)
+      {
+        auto box = getFBox();
+        box.pos += delta;
+        return physics->findTile(roundBox(box), TILE_HAZARD);
+      };
+
+    // the tiles touched by the left and bottom edges too
+    auto touching = getBox();
+    touching.pos.x -= 1;
+    touching.pos.y -= 1;
+    touching.size.width += 1;
+    touching.size.height += 1;
+
+    if(physics->findTile(touching, TILE_HAZARD))
+      onDamage(1000);
+    else if((!trace.horz && bumps(Vector(vel.x, 0))) || (!trace.vert && bumps(Vector(0, vel.y))))
+      onDamage(1000);
   }
 
   void subTick()
@@ -411,6 +450,7 @@ struct Rockman : Player, Damageable, Resurrectable
     computeVelocity(control);
 
     auto trace = slideMove(this, vel);
+    checkHazards(trace);
 
     if(!trace.vert)
       vel.y = 0;
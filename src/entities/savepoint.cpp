@@ -49,7 +49,7 @@ struct SavePoint : Entity
     if(dynamic_cast<Player*>(other) && !timer)
     {
       game->playSound(SND_SAVEPOINT);
-      game->postEvent(make_unique<SaveEvent>());
+      game->postEvent(SaveEvent());
       game->textBox("Game Saved");
       timer = 500;
     }
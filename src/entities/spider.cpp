@@ -36,15 +36,19 @@ struct SpiderBullet : Entity
     actors.push_back(r);
   }
 
-  void tick() override
+  void prepare() override
   {
-    pos += vel;
     decrement(life);
 
     if(life == 0)
       dead = true;
   }
 
+  void tick() override
+  {
+    pos += vel;
+  }
+
   void onCollide(Body* other)
   {
     if(auto damageable = dynamic_cast<Damageable*>(other))
@@ -86,12 +90,15 @@ struct Spider : Entity, Damageable
     actors.push_back(r);
   }
 
-  virtual void tick() override
+  virtual void prepare() override
   {
     ++time;
 
     decrement(blinking);
+  }
 
+  virtual void tick() override
+  {
     if(time % 150 == 0)
     {
       auto target = game->getPlayerPosition();
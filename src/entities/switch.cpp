@@ -31,6 +31,12 @@ struct Switch : Entity
     state = var->get();
   }
 
+  // another switch might have changed the variable
+  void resume() override
+  {
+    enter();
+  }
+
   virtual void addActors(vector<Actor>& actors) const override
   {
     auto r = Actor { pos, MDL_SWITCH };
@@ -72,5 +78,5 @@ unique_ptr<Entity> makeSwitch(int id)
 }
 
 #include "entity_factory.h"
-static auto const reg1 = registerEntity("switch", [] (IEntityConfig* cfg) { auto arg = cfg->getInt("0"); return makeSwitch(arg); });
+static auto const reg1 = registerEntity("switch", [] (IEntityConfig* cfg) { auto arg = cfg->getInt(0); return makeSwitch(arg); }, { "0" });
 
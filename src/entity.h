@@ -19,11 +19,6 @@
 
 using namespace std;
 
-struct Climbable
-{
-  virtual ~Climbable() = default;
-};
-
 struct Damageable
 {
   virtual void onDamage(int amount) = 0;
@@ -38,8 +33,27 @@ struct Entity : Body
 {
   virtual ~Entity() = default;
 
+  // from the current entity pool, if any (see entity_pool.h)
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr);
+
   virtual void enter() {}
   virtual void leave() {}
+
+  // the room is entered again, after having been suspended (see room_cache.h)
+  virtual void resume() {}
+
+  // First phase of a tick: runs in parallel with the other entities.
+  // Must only touch the entity's own state: no physics, no game,
+  // no position, no collision flags.
+  // Collision handlers may write the same fields (e.g a timer): they're
+  // called by 'moveBody' and 'sweepBody' during the 'tick' of any entity,
+  // or by 'checkForOverlaps', and both run after every 'prepare' is done.
+  // So a handler's write is seen by the next frame's 'prepare', whatever
+  // the number of threads.
+  virtual void prepare() {}
+
+  // Second phase of a tick: runs serially, in entity order.
   virtual void tick() {}
 
   virtual void addActors(vector<Actor>& actors) const = 0;
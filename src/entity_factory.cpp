@@ -10,31 +10,89 @@
 #include "entity_factory.h"
 #include <map>
 #include <stdexcept>
+#include <vector>
 
 using namespace std;
 
 namespace
 {
-map<string, CreationFunc>& g_registry()
+struct Registry
 {
-  static map<string, CreationFunc> registry;
+  map<string, int> indices;
+  vector<CreationFunc> funcs;
+  vector<vector<string>> params;
+};
+
+// Only written during static initialization (see 'registerEntity' calls),
+// so game instances running on different threads can share it.
+Registry& g_registry()
+{
+  static Registry registry;
   return registry;
 }
 }
 
-int registerEntity(string type, CreationFunc func)
+int registerEntity(string type, CreationFunc func, vector<string> params)
 {
-  g_registry()[type] = func;
+  auto& registry = g_registry();
+  auto i = registry.indices.find(type);
+
+  if(i != registry.indices.end())
+  {
+    registry.funcs[i->second] = func;
+    registry.params[i->second] = move(params);
+  }
+  else
+  {
+    registry.indices[type] = (int)registry.funcs.size();
+    registry.funcs.push_back(func);
+    registry.params.push_back(move(params));
+  }
+
   return 0; // ignored
 }
 
 unique_ptr<Entity> createEntity(string name, IEntityConfig* args)
 {
-  auto i_func = g_registry().find(name);
+  auto const factory = findEntityFactory(name);
 
-  if(i_func == g_registry().end())
+  if(factory < 0)
     throw runtime_error("unknown entity type: '" + name + "'");
 
-  return (*i_func).second(args);
+  return createEntity(factory, args);
+}
+
+int findEntityFactory(string name)
+{
+  auto& registry = g_registry();
+  auto i = registry.indices.find(name);
+
+  if(i == registry.indices.end())
+    return -1;
+
+  return i->second;
+}
+
+vector<string> const& getEntityParams(int factory)
+{
+  return g_registry().params[factory];
+}
+
+int findEntityParam(int factory, string name)
+{
+  auto& params = getEntityParams(factory);
+
+  for(int i = 0; i < (int)params.size(); ++i)
+  {
+    if(params[i] == name)
+      return i;
+  }
+
+  return -1;
+}
+
+unique_ptr<Entity> createEntity(int factory, IEntityConfig* args)
+{
+  return g_registry().funcs[factory](args);
 }
 
@@ -8,15 +8,18 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 using namespace std;
 
 struct Entity;
 
+// 'param': index of the argument in the parameter names given to
+// 'registerEntity', so no name is looked up when spawning.
 struct IEntityConfig
 {
-  virtual string getString(const char* varName, string defaultValue = "") = 0;
-  virtual int getInt(const char* varName, int defaultValue = 0) = 0;
+  virtual string getString(int param, string defaultValue = "") = 0;
+  virtual int getInt(int param, int defaultValue = 0) = 0;
 };
 
 // e.g:
@@ -24,6 +27,18 @@ struct IEntityConfig
 // createEntity("door(4)");
 std::unique_ptr<Entity> createEntity(string name, IEntityConfig* config);
 
+// Resolves the type name once, for repeated creations.
+// -1 if the type is unknown.
+int findEntityFactory(string name);
+std::unique_ptr<Entity> createEntity(int factory, IEntityConfig* config);
+
 using CreationFunc = unique_ptr<Entity>(*)(IEntityConfig* args);
-int registerEntity(string type, CreationFunc func);
+
+// 'params': the names of the arguments 'func' reads, by index.
+// "0", "1" ... are the arguments of the call, e.g "door(4)".
+int registerEntity(string type, CreationFunc func, vector<string> params = {});
+vector<string> const& getEntityParams(int factory);
+
+// index of the parameter 'name' of 'factory', or -1
+int findEntityParam(int factory, string name);
 
@@ -0,0 +1,192 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "entity_pool.h"
+#include "entity.h"
+#include <algorithm> // none_of
+#include <atomic>
+#include <cassert>
+#include <functional> // less
+#include <new>
+
+namespace
+{
+thread_local EntityPool* t_currentPool = nullptr;
+atomic<uint32_t> g_nextSerial(1);
+}
+
+// Precedes each block. Keeps the block size suitably aligned.
+struct alignas(16) EntityPool::Header
+{
+  EntityPool* owner; // null for heap blocks
+  Header* nextFree;
+  uint32_t index;
+  int sizeClass;
+};
+
+EntityPool::EntityPool() :
+  m_serial(g_nextSerial++)
+{
+}
+
+EntityPool::~EntityPool()
+{
+  assert(m_liveBlocks == 0);
+}
+
+void* EntityPool::allocate(size_t size)
+{
+  auto const sizeClass = int((size + GRANULARITY - 1) / GRANULARITY);
+
+  if(sizeClass >= SIZE_CLASSES)
+    return allocateFromHeap(size);
+
+  auto header = m_freeLists[sizeClass];
+
+  if(header)
+    m_freeLists[sizeClass] = header->nextFree;
+  else
+    header = carve(sizeClass);
+
+  m_generations[header->index]++;
+  m_liveBlocks++;
+
+  return header + 1;
+}
+
+void* EntityPool::allocateFromHeap(size_t size)
+{
+  auto header = (Header*)::operator new(sizeof(Header) + size);
+  header->owner = nullptr;
+  return header + 1;
+}
+
+void EntityPool::release(void* ptr)
+{
+  if(!ptr)
+    return;
+
+  auto header = (Header*)ptr - 1;
+  auto pool = header->owner;
+
+  if(!pool)
+  {
+    ::operator delete(header);
+    return;
+  }
+
+  pool->m_generations[header->index]++;
+  pool->m_liveBlocks--;
+
+  header->nextFree = pool->m_freeLists[header->sizeClass];
+  pool->m_freeLists[header->sizeClass] = header;
+}
+
+void EntityPool::reset()
+{
+  assert(m_liveBlocks == 0);
+
+  m_chunks.clear();
+  m_chunkUsed = CHUNK_SIZE;
+
+  for(auto& list : m_freeLists)
+    list = nullptr;
+
+  // keep the generations: the new blocks reuse the indices,
+  // and the old handles must not resolve to them.
+  m_blockCount = 0;
+}
+
+EntityPool::Header* EntityPool::carve(int sizeClass)
+{
+  static_assert(sizeof(Header) % GRANULARITY == 0, "misaligned blocks");
+
+  auto const blockSize = sizeof(Header) + sizeClass * GRANULARITY;
+
+  if(m_chunkUsed + blockSize > CHUNK_SIZE)
+  {
+    m_chunks.push_back(unique_ptr<uint8_t[]>(new uint8_t[CHUNK_SIZE]));
+    m_chunkUsed = 0;
+  }
+
+  auto header = (Header*)(m_chunks.back().get() + m_chunkUsed);
+  m_chunkUsed += blockSize;
+
+  header->owner = this;
+  header->nextFree = nullptr;
+  header->index = m_blockCount++;
+  header->sizeClass = sizeClass;
+
+  if((int)m_generations.size() < m_blockCount)
+    m_generations.push_back(0);
+
+  return header;
+}
+
+EntityHandle EntityPool::handleOf(Entity* entity) const
+{
+  // the block starts with the most derived object
+  auto const block = (const uint8_t*)dynamic_cast<const void*>(entity);
+
+  // Only blocks carved out of our chunks have a header we can read:
+  // the entity might come from the heap, from another pool, or not
+  // from 'operator new' at all.
+  auto inChunk = [&] (unique_ptr<uint8_t[]> const& chunk)
+    {
+      less<const uint8_t*> before;
+      return !before(block, chunk.get()) && before(block, chunk.get() + CHUNK_SIZE);
+    };
+
+  if(none_of(m_chunks.begin(), m_chunks.end(), inChunk))
+    return {};
+
+  auto header = (const Header*)block - 1;
+
+  return { entity, m_serial, header->index, m_generations[header->index] };
+}
+
+Entity* EntityPool::resolve(EntityHandle handle) const
+{
+  if(handle.pool != m_serial || handle.index >= m_generations.size())
+    return nullptr;
+
+  // also rejects the handles issued before a 'reset'
+  if(m_generations[handle.index] != handle.generation)
+    return nullptr;
+
+  return handle.entity;
+}
+
+EntityPool* EntityPool::current()
+{
+  return t_currentPool;
+}
+
+EntityPoolScope::EntityPoolScope(EntityPool* pool) :
+  m_previous(t_currentPool)
+{
+  t_currentPool = pool;
+}
+
+EntityPoolScope::~EntityPoolScope()
+{
+  t_currentPool = m_previous;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void* Entity::operator new(size_t size)
+{
+  if(auto pool = EntityPool::current())
+    return pool->allocate(size);
+
+  return EntityPool::allocateFromHeap(size);
+}
+
+void Entity::operator delete(void* ptr)
+{
+  EntityPool::release(ptr);
+}
@@ -0,0 +1,105 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Allocator for the entities of a room.
+// Blocks are carved out of large chunks, one free list per size class,
+// so short-lived entities (bullets, explosions ...) don't churn the heap.
+// 'Entity::operator new' allocates from the current pool of the thread,
+// or from the heap if there's none (see EntityPoolScope).
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+struct Entity;
+
+// Stays valid when the entity dies: it then resolves to null.
+struct EntityHandle
+{
+  Entity* entity = nullptr;
+  uint32_t pool = 0; // serial number of the issuing pool
+  uint32_t index = 0;
+  uint32_t generation = 0; // zero: null handle
+};
+
+struct EntityPool
+{
+  EntityPool();
+  ~EntityPool();
+
+  EntityPool(EntityPool const &) = delete;
+  void operator = (EntityPool const &) = delete;
+
+  void* allocate(size_t size);
+
+  // same block layout as 'allocate', but from the heap
+  static void* allocateFromHeap(size_t size);
+
+  // works for blocks of any pool, and for blocks from the heap
+  static void release(void* ptr);
+
+  // Frees all the chunks at once. All the blocks must have been released.
+  // The handles stay safe to resolve.
+  void reset();
+
+  // null handle if the entity doesn't come from this pool
+  // (e.g from the heap, or not allocated by 'Entity::operator new')
+  EntityHandle handleOf(Entity* entity) const;
+
+  // null if the entity is dead, or if it comes from another pool
+  Entity* resolve(EntityHandle handle) const;
+
+  int liveBlocks() const { return m_liveBlocks; }
+
+  // bytes taken by the chunks, free blocks included
+  size_t memoryUsage() const { return m_chunks.size() * CHUNK_SIZE; }
+
+  // the pool used by 'Entity::operator new' on this thread
+  static EntityPool* current();
+
+private:
+  friend struct EntityPoolScope;
+
+  struct Header;
+
+  enum { GRANULARITY = 16 };
+  enum { SIZE_CLASSES = 64 }; // blocks up to 1 KB, bigger ones come from the heap
+  enum { CHUNK_SIZE = 64 * 1024 };
+
+  Header* carve(int sizeClass);
+
+  // unique among all the pools: rooms swap pools, a handle must not
+  // resolve in a pool that happens to reuse the same block index.
+  uint32_t const m_serial;
+
+  vector<unique_ptr<uint8_t[]>> m_chunks;
+  size_t m_chunkUsed = CHUNK_SIZE;
+
+  Header* m_freeLists[SIZE_CLASSES] {};
+
+  // indexed by block index. Odd: the block is in use.
+  vector<uint32_t> m_generations;
+  int m_blockCount = 0;
+
+  int m_liveBlocks = 0;
+};
+
+// Makes 'pool' the current pool of the thread, for the scope lifetime.
+// 'pool' can be null, for heap allocation.
+struct EntityPoolScope
+{
+  EntityPoolScope(EntityPool* pool);
+  ~EntityPoolScope();
+
+private:
+  EntityPool* const m_previous;
+};
+
@@ -0,0 +1,132 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "event_bus.h"
+
+#include <cassert>
+#include <cstring> // memcpy
+
+static int alignRecord(int size)
+{
+  return (size + 7) & ~7;
+}
+
+EventBus::EventBus(int capacity)
+{
+  m_capacity = alignRecord(capacity);
+  m_ring.resize(m_capacity / 8);
+}
+
+void EventBus::post(int id, const void* payload, int size)
+{
+  assert(id >= 0 && id < MAX_EVENT_TYPES);
+
+  auto const recordSize = alignRecord(sizeof(Header) + size);
+
+  auto offset = int(m_tail % m_capacity);
+  auto untilEnd = m_capacity - offset;
+
+  // records are never split: skip the end of the buffer if needed
+  auto padding = recordSize > untilEnd ? untilEnd : 0;
+
+  if(m_tail - m_head + padding + recordSize > uint64_t(m_capacity))
+  {
+    grow(recordSize);
+    offset = int(m_tail % m_capacity);
+    padding = 0;
+  }
+
+  auto const bytes = reinterpret_cast<uint8_t*>(m_ring.data());
+
+  if(padding)
+  {
+    Header pad { -1, padding };
+    memcpy(bytes + offset, &pad, sizeof pad);
+    m_tail += padding;
+    offset = 0;
+  }
+
+  Header header { id, recordSize };
+  memcpy(bytes + offset, &header, sizeof header);
+  memcpy(bytes + offset + sizeof header, payload, size);
+  m_tail += recordSize;
+}
+
+void EventBus::grow(int minFree)
+{
+  auto const used = int(m_tail - m_head);
+
+  auto capacity = m_capacity * 2;
+
+  while(capacity < used + minFree)
+    capacity *= 2;
+
+  vector<uint64_t> ring(capacity / 8);
+
+  auto const src = reinterpret_cast<const uint8_t*>(m_ring.data());
+  auto const dst = reinterpret_cast<uint8_t*>(ring.data());
+
+  // the pending records, in order, from the start of the new buffer
+  uint64_t pos = 0;
+  uint64_t dispatchEnd = 0;
+
+  for(auto i = m_head; i != m_tail;)
+  {
+    if(i == m_dispatchEnd)
+      dispatchEnd = pos;
+
+    auto const record = src + i % m_capacity;
+
+    Header header;
+    memcpy(&header, record, sizeof header);
+
+    if(header.id >= 0)
+    {
+      memcpy(dst + pos, record, header.size);
+      pos += header.size;
+    }
+
+    i += header.size;
+  }
+
+  if(m_tail == m_dispatchEnd)
+    dispatchEnd = pos;
+
+  if(m_dispatching)
+  {
+    m_dispatchEnd = dispatchEnd;
+    m_retired.push_back(move(m_ring));
+  }
+
+  m_ring = move(ring);
+  m_capacity = capacity;
+  m_head = 0;
+  m_tail = pos;
+}
+
+void EventBus::dispatch()
+{
+  m_dispatching = true;
+  m_dispatchEnd = m_tail;
+
+  while(m_head != m_dispatchEnd)
+  {
+    // a handler might grow the buffer
+    auto const record = reinterpret_cast<const uint8_t*>(m_ring.data()) + m_head % m_capacity;
+
+    Header header;
+    memcpy(&header, record, sizeof header);
+
+    // the record stays allocated while its handler runs
+    if(header.id >= 0 && m_handlers[header.id])
+      m_handlers[header.id](record + sizeof header);
+
+    m_head += header.size;
+  }
+
+  m_dispatching = false;
+  m_retired.clear();
+}
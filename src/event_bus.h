@@ -0,0 +1,85 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Typed events, without heap allocations.
+// An event type is a plain struct with a compile-time 'ID' (see game.h).
+// Posted events are copied inline into a ring buffer, and 'dispatch'
+// calls the handler of each one through a table indexed by 'ID'.
+// A full ring buffer doubles its size: nothing gets lost, and a well-sized
+// buffer doesn't allocate once the game is running.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+struct EventBus
+{
+  static auto const MAX_EVENT_TYPES = 16;
+
+  // 'capacity': initial size of the ring buffer, in bytes
+  explicit EventBus(int capacity = 4096);
+
+  template<typename T>
+  void subscribe(function<void(T const &)> handler)
+  {
+    static_assert(T::ID < MAX_EVENT_TYPES, "event ID out of range");
+    m_handlers[T::ID] = [handler] (const void* payload) { handler(*static_cast<const T*>(payload)); };
+  }
+
+  template<typename T>
+  void post(T const& event)
+  {
+    static_assert(is_trivially_copyable<T>::value, "events are copied as raw bytes");
+    static_assert(alignof(T) <= 8, "records are 8-byte aligned");
+    static_assert(T::ID < MAX_EVENT_TYPES, "event ID out of range");
+    post(T::ID, &event, sizeof event);
+  }
+
+  void post(int id, const void* payload, int size);
+
+  // calls the handlers of the events posted until now, in posting order.
+  // The events they post are kept for the next call.
+  // Events without a handler are dropped.
+  void dispatch();
+
+  bool empty() const { return m_head == m_tail; }
+
+  int capacity() const { return m_capacity; }
+
+private:
+  struct Header
+  {
+    int32_t id; // -1: padding, until the end of the buffer
+    int32_t size; // of the whole record, header included
+  };
+
+  // moves the pending records to a bigger buffer, with at least 'minFree'
+  // contiguous bytes after them
+  void grow(int minFree);
+
+  vector<uint64_t> m_ring; // 8-byte aligned records
+  int m_capacity;
+
+  // byte offsets, growing forever (the ring position is modulo 'm_capacity')
+  uint64_t m_head = 0; // first unread record
+  uint64_t m_tail = 0; // end of the last posted record
+
+  // while dispatching: end of the records of the current call
+  bool m_dispatching = false;
+  uint64_t m_dispatchEnd = 0;
+
+  // buffers replaced during a dispatch: the running handler might still
+  // be reading its event from one of them
+  vector<vector<uint64_t>> m_retired;
+
+  function<void(const void*)> m_handlers[MAX_EVENT_TYPES];
+};
+
@@ -10,6 +10,7 @@
 
 #include <memory>
 #include <functional>
+#include <type_traits>
 #include "base/geom.h"
 #include "base/scene.h"
 #include "base/view.h"
@@ -21,20 +22,19 @@ typedef Matrix2<int> Matrix;
 
 struct Entity;
 
-struct Event
+// Events are plain data, copied by value (see EventBus).
+// Each type has its own ID, below.
+enum
 {
-  // force a vtable so we can dynamic_cast events
-  virtual ~Event() = default;
-
-  template<typename T>
-  const T* as() const
-  {
-    return dynamic_cast<const T*>(this);
-  }
+  EVENT_TOUCH_LEVEL_BOUNDARY,
+  EVENT_SAVE,
+  EVENT_FINISH_GAME,
 };
 
-struct TouchLevelBoundary : Event
+struct TouchLevelBoundary
 {
+  static int const ID = EVENT_TOUCH_LEVEL_BOUNDARY;
+
   TouchLevelBoundary(int targetLevel_, Vector transform_)
   {
     targetLevel = targetLevel_;
@@ -45,12 +45,14 @@ struct TouchLevelBoundary : Event
   Vector transform {};
 };
 
-struct SaveEvent : Event
+struct SaveEvent
 {
+  static int const ID = EVENT_SAVE;
 };
 
-struct FinishGameEvent : Event
+struct FinishGameEvent
 {
+  static int const ID = EVENT_FINISH_GAME;
 };
 
 struct Handle
@@ -82,8 +84,18 @@ struct IGame
   // logic
   virtual void spawn(Entity* e) = 0;
   virtual IVariable* getVariable(int name) = 0;
-  virtual void postEvent(unique_ptr<Event> event) = 0;
+  virtual void postEvent(int id, const void* payload, int size) = 0; // see the typed version below
   virtual Vector getPlayerPosition() = 0;
   virtual void respawn() = 0;
+
+  // in [0 .. 32767]. Each game instance has its own sequence.
+  virtual int random() = 0;
+
+  template<typename T>
+  void postEvent(T const& event)
+  {
+    static_assert(is_trivially_copyable<T>::value, "events are copied as raw bytes");
+    postEvent(T::ID, &event, sizeof event);
+  }
 };
 
@@ -0,0 +1,429 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Headless runner: runs the game logic as fast as possible,
+// with no display, no audio and no timing.
+// The input is either a replay file (see engine/src/misc/replay.h),
+// or a script file whose lines are:
+//
+//   <tick count> [key...]
+//
+// where 'key' is one of: left, right, up, down, start, fire, jump, dash,
+// restart, debug. The script is repeated until the requested tick count.
+//
+// Prints one JSON object, e.g:
+// {"ticks":10000,"seconds":0.314,"ticks_per_second":31847.1,"hash":"9e3f06a1",
+//  "room_cache_hits":3,"room_cache_misses":5,"room_cache_evictions":0}
+// The hash covers everything the final frame sends to the view.
+// --room-cache sets the memory budget of the suspended rooms (see RoomCache).
+//
+// When playing a replay, the state checksum of each tick is compared
+// to the recorded one, and the run stops at the first divergence.
+//
+// In batch mode, N independent game instances sharing the same quest
+// are run by a pool of 1, 2, 4 ... up to --threads threads, and one
+// JSON object is printed per thread count.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // atoi, srand
+#include <cstring> // strcmp
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/scene.h"
+#include "base/view.h"
+#include "engine/src/misc/clock.h"
+#include "engine/src/misc/jobs.h"
+#include "engine/src/misc/replay.h"
+#include "load_quest.h"
+#include "preprocess_quest.h"
+#include "spawn_program.h"
+#include "state_machine.h" // createPlayingStateForQuest
+
+using namespace std;
+
+Scene* createGame(View* view, vector<string> argv);
+
+namespace
+{
+struct NullView : View
+{
+  void setTitle(char const*) override {}
+  void preload(Resource) override {}
+  void textBox(char const*) override {}
+  void playMusic(MUSIC) override {}
+  void stopMusic() override {}
+  void playSound(SOUND) override {}
+  void setCameraPos(Vector2f) override {}
+  void setAmbientLight(float) override {}
+
+  void sendActor(Actor const& actor) override
+  {
+    hash.add(actor);
+  }
+
+  FrameHash hash;
+};
+
+struct Step
+{
+  int count;
+  Control control;
+};
+
+Control parseControl(istream& words)
+{
+  Control r {};
+  string word;
+
+  while(words >> word)
+  {
+    if(word == "left")
+      r.left = true;
+    else if(word == "right")
+      r.right = true;
+    else if(word == "up")
+      r.up = true;
+    else if(word == "down")
+      r.down = true;
+    else if(word == "start")
+      r.start = true;
+    else if(word == "fire")
+      r.fire = true;
+    else if(word == "jump")
+      r.jump = true;
+    else if(word == "dash")
+      r.dash = true;
+    else if(word == "restart")
+      r.restart = true;
+    else if(word == "debug")
+      r.debug = true;
+    else
+      throw runtime_error("Unknown key in script: '" + word + "'");
+  }
+
+  return r;
+}
+
+vector<Step> loadScript(string path)
+{
+  ifstream fp(path);
+
+  if(!fp)
+    throw runtime_error("Can't open script file '" + path + "'");
+
+  vector<Step> r;
+  string line;
+
+  while(getline(fp, line))
+  {
+    if(line.empty() || line[0] == '#')
+      continue;
+
+    istringstream words(line);
+    Step step;
+
+    if(!(words >> step.count) || step.count <= 0)
+      throw runtime_error("Invalid script line: '" + line + "'");
+
+    step.control = parseControl(words);
+    r.push_back(step);
+  }
+
+  if(r.empty())
+    throw runtime_error("Empty script file '" + path + "'");
+
+  return r;
+}
+
+// run right, jumping and firing from time to time
+vector<Step> defaultScript()
+{
+  Control run {};
+  run.right = true;
+
+  Control jump = run;
+  jump.jump = true;
+  jump.fire = true;
+
+  return { { 80, run }, { 20, jump } };
+}
+
+vector<Control> expandScript(vector<Step> const& script, int numTicks)
+{
+  vector<Control> r;
+
+  for(int step = 0; (int)r.size() < numTicks; step = (step + 1) % script.size())
+  {
+    for(int k = 0; k < script[step].count && (int)r.size() < numTicks; ++k)
+      r.push_back(script[step].control);
+  }
+
+  return r;
+}
+
+void tickScene(unique_ptr<Scene>& scene, Control c)
+{
+  auto next = scene->tick(c);
+
+  // same ownership rules as App::tick
+  if(next != scene.get())
+  {
+    scene.release();
+    scene.reset(next);
+  }
+}
+
+void addStats(GameStats& total, GameStats const& stats)
+{
+  total.roomCacheHits += stats.roomCacheHits;
+  total.roomCacheMisses += stats.roomCacheMisses;
+  total.roomCacheEvictions += stats.roomCacheEvictions;
+}
+
+uint32_t computeChecksum(Scene* scene, NullView& view)
+{
+  view.hash = FrameHash();
+  scene->draw();
+  return view.hash.value;
+}
+
+// Runs one tick per control.
+// If 'expected' isn't null, stops at the first tick whose checksum differs.
+// If 'record' isn't null, appends the ticks to it.
+// Returns false on divergence.
+bool run(vector<string> args, uint32_t seed, vector<Control> const& controls, const Replay* expected, Replay* record)
+{
+  auto const checkEveryTick = expected || record;
+
+  // the game draws its seed from 'rand'
+  srand(seed);
+
+  NullView view;
+  unique_ptr<Scene> scene(createGame(&view, args));
+
+  auto const t0 = now();
+
+  for(int i = 0; i < (int)controls.size(); ++i)
+  {
+    tickScene(scene, controls[i]);
+
+    if(!checkEveryTick)
+      continue;
+
+    auto const checksum = computeChecksum(scene.get(), view);
+
+    if(record)
+      record->ticks.push_back({ controls[i], checksum });
+
+    if(expected && checksum != expected->ticks[i].checksum)
+    {
+      fprintf(stderr, "Diverged at tick %d: expected checksum %08x, got %08x\n", i, expected->ticks[i].checksum, checksum);
+      return false;
+    }
+  }
+
+  auto const t1 = now();
+
+  auto const stats = getGameStats(scene.get());
+
+  printf("{\"ticks\":%d,\"seconds\":%.3f,\"ticks_per_second\":%.1f,\"hash\":\"%08x\",\"room_cache_hits\":%d,\"room_cache_misses\":%d,\"room_cache_evictions\":%d}\n",
+         (int)controls.size(),
+         t1 - t0,
+         controls.size() / max(t1 - t0, 1e-9),
+         computeChecksum(scene.get(), view),
+         stats.roomCacheHits,
+         stats.roomCacheMisses,
+         stats.roomCacheEvictions);
+
+  return true;
+}
+
+struct Instance
+{
+  NullView view;
+  unique_ptr<Scene> scene;
+};
+
+// Runs 'numInstances' games on 'numThreads' threads.
+// Each thread takes the next instance not yet run, and runs all its ticks.
+void runBatch(shared_ptr<const Quest> quest, int level, uint32_t seed, vector<Control> const& controls, int numInstances, int numThreads)
+{
+  vector<Instance> instances(numInstances);
+
+  for(int i = 0; i < numInstances; ++i)
+  {
+    auto& instance = instances[i];
+    instance.scene.reset(createPlayingStateForQuest(&instance.view, quest, level, seed + i));
+  }
+
+  atomic<int> nextInstance(0);
+
+  auto worker = [&] ()
+    {
+      int i;
+
+      while((i = nextInstance++) < numInstances)
+      {
+        for(auto& c : controls)
+          tickScene(instances[i].scene, c);
+      }
+    };
+
+  auto const t0 = now();
+
+  vector<thread> pool;
+
+  for(int k = 0; k < numThreads; ++k)
+    pool.push_back(thread(worker));
+
+  for(auto& t : pool)
+    t.join();
+
+  auto const t1 = now();
+
+  // doesn't depend on the thread count
+  uint32_t hash = 0;
+  GameStats stats;
+
+  for(auto& instance : instances)
+  {
+    hash = hash * 31 + computeChecksum(instance.scene.get(), instance.view);
+    addStats(stats, getGameStats(instance.scene.get()));
+  }
+
+  auto const totalTicks = double(numInstances) * controls.size();
+
+  printf("{\"threads\":%d,\"instances\":%d,\"ticks\":%d,\"seconds\":%.3f,\"ticks_per_second\":%.1f,\"hash\":\"%08x\",\"room_cache_hits\":%d,\"room_cache_misses\":%d,\"room_cache_evictions\":%d}\n",
+         numThreads,
+         numInstances,
+         (int)controls.size(),
+         t1 - t0,
+         totalTicks / max(t1 - t0, 1e-9),
+         hash,
+         stats.roomCacheHits,
+         stats.roomCacheMisses,
+         stats.roomCacheEvictions);
+  fflush(stdout);
+}
+}
+
+int main(int argc, const char* argv[])
+{
+  int numTicks = 10000;
+  int level = 1;
+  int seed = 0;
+  string scriptPath;
+  string recordPath;
+  string replayPath;
+  int numInstances = 0;
+  int maxThreads = max(1, (int)thread::hardware_concurrency());
+  int numWorkers = 0;
+  int roomCacheBudget = -1;
+
+  try
+  {
+    for(int i = 1; i < argc; ++i)
+    {
+      auto const arg = argv[i];
+      auto const hasValue = i + 1 < argc;
+
+      if(!strcmp(arg, "--ticks") && hasValue)
+        numTicks = atoi(argv[++i]);
+      else if(!strcmp(arg, "--level") && hasValue)
+        level = atoi(argv[++i]);
+      else if(!strcmp(arg, "--seed") && hasValue)
+        seed = atoi(argv[++i]);
+      else if(!strcmp(arg, "--script") && hasValue)
+        scriptPath = argv[++i];
+      else if(!strcmp(arg, "--record") && hasValue)
+        recordPath = argv[++i];
+      else if(!strcmp(arg, "--replay") && hasValue)
+        replayPath = argv[++i];
+      else if(!strcmp(arg, "--batch") && hasValue)
+        numInstances = atoi(argv[++i]);
+      else if(!strcmp(arg, "--threads") && hasValue)
+        maxThreads = atoi(argv[++i]);
+      else if(!strcmp(arg, "--jobs") && hasValue)
+        numWorkers = atoi(argv[++i]);
+      else if(!strcmp(arg, "--room-cache") && hasValue)
+        roomCacheBudget = atoi(argv[++i]);
+      else
+        throw runtime_error(string("Invalid argument: '") + arg + "'");
+    }
+
+    if(numTicks <= 0)
+      throw runtime_error("Invalid tick count");
+
+    if(numInstances < 0 || maxThreads <= 0)
+      throw runtime_error("Invalid batch parameters");
+
+    if(numWorkers < 0)
+      throw runtime_error("Invalid job worker count");
+
+    if(roomCacheBudget >= 0)
+      setRoomCacheBudget(roomCacheBudget);
+
+    // results don't depend on it: see Entity::prepare
+    startJobSystem(numWorkers);
+
+    if(!replayPath.empty())
+    {
+      auto const replay = loadReplay(replayPath);
+
+      vector<Control> controls;
+
+      for(auto& tick : replay.ticks)
+        controls.push_back(tick.control);
+
+      return run(replay.args, replay.seed, controls, &replay, nullptr) ? 0 : 2;
+    }
+
+    auto const script = scriptPath.empty() ? defaultScript() : loadScript(scriptPath);
+
+    if(numInstances > 0)
+    {
+      auto quest = make_shared<Quest>(loadQuest("res/quest.json"));
+      preprocessQuest(*quest, seed);
+      compileSpawnPrograms(*quest);
+
+      auto const controls = expandScript(script, numTicks);
+
+      for(int numThreads = 1; numThreads < maxThreads; numThreads *= 2)
+        runBatch(quest, level, seed, controls, numInstances, numThreads);
+
+      runBatch(quest, level, seed, controls, numInstances, maxThreads);
+      return 0;
+    }
+
+    Replay record;
+    record.seed = seed;
+    record.args = { to_string(level) };
+
+    run(record.args, record.seed, expandScript(script, numTicks), nullptr, recordPath.empty() ? nullptr : &record);
+
+    if(!recordPath.empty())
+      saveReplay(record, recordPath);
+
+    return 0;
+  }
+  catch(exception const& e)
+  {
+    fprintf(stderr, "Fatal: %s\n", e.what());
+    fprintf(stderr, "Usage: %s --replay <file> [--jobs N] [--room-cache <bytes>]\n", argv[0]);
+    fprintf(stderr, "       %s [--ticks N] [--level N] [--seed N] [--script <file>] [--record <file>] [--jobs N] [--room-cache <bytes>]\n", argv[0]);
+    fprintf(stderr, "       %s --batch N [--threads N] [--ticks N] [--level N] [--seed N] [--script <file>] [--room-cache <bytes>]\n", argv[0]);
+    return 1;
+  }
+}
+
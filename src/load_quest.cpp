@@ -18,6 +18,7 @@
 #include "engine/src/misc/decompress.h"
 
 #include "quest.h"
+#include "tile_attribute.h"
 
 static
 vector<int> convertFromLittleEndian(vector<uint8_t> const& input)
@@ -133,7 +134,6 @@ Matrix2<int> parseTileLayer(json::Value& json)
 
 static auto const CELL_SIZE = 16;
 
-static
 void generateConcreteRoom(Room& room)
 {
   auto const rect = room.size * CELL_SIZE;
@@ -216,7 +216,9 @@ void loadConcreteRoom(Room& room, json::Value const& jsRoom)
   if(exists(layers, "things"))
     room.spawners = parseThingLayer(layers["things"], room.size.height * 16);
 
-  // add spikes and ladders
+  // spikes and ladders are tile attributes, not tiles
+  room.attributes.resize(room.tiles.size);
+
   for(auto pos : rasterScan(room.tiles.size.width, room.tiles.size.height))
   {
     auto const x = pos.first;
@@ -225,14 +227,12 @@ void loadConcreteRoom(Room& room, json::Value const& jsRoom)
 
     if(tile == 9)
     {
-      auto const pos = Vector(x, y);
-      room.spawners.push_back({ pos, "spikes" });
+      room.attributes.set(x, y, 1 << TILE_HAZARD);
       room.tiles.set(x, y, 0);
     }
     else if(tile == 10)
     {
-      auto const pos = Vector(x, y);
-      room.spawners.push_back({ pos, "ladder" });
+      room.attributes.set(x, y, 1 << TILE_CLIMBABLE);
       room.tiles.set(x, y, 0);
     }
   }
@@ -4,3 +4,6 @@
 
 Quest loadQuest(string path);
 
+// placeholder tiles for rooms without a room file.
+// 'room.size' is in cells (16x16 tiles).
+void generateConcreteRoom(Room& room);
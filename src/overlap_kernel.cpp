@@ -0,0 +1,97 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "overlap_kernel.h"
+#include <cassert>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+// same as 'segmentsOverlap(a_left, a_right, b_left, b_right)',
+// including its treatment of empty segments.
+inline bool segmentsOverlap(int a_left, int a_right, int b_left, int b_right)
+{
+  return a_left > b_left ? a_left < b_right : b_left < a_right;
+}
+
+uint64_t scalarTail(IntBox query, const int* x1, const int* y1, const int* x2, const int* y2, int first, int count)
+{
+  auto const qx1 = query.pos.x;
+  auto const qy1 = query.pos.y;
+  auto const qx2 = query.pos.x + query.size.width;
+  auto const qy2 = query.pos.y + query.size.height;
+
+  uint64_t r = 0;
+
+  for(int i = first; i < count; ++i)
+  {
+    if(segmentsOverlap(x1[i], x2[i], qx1, qx2) && segmentsOverlap(y1[i], y2[i], qy1, qy2))
+      r |= uint64_t(1) << i;
+  }
+
+  return r;
+}
+}
+
+uint64_t overlapMaskScalar(IntBox query, const int* x1, const int* y1, const int* x2, const int* y2, int count)
+{
+  assert(count <= 64);
+  return scalarTail(query, x1, y1, x2, y2, 0, count);
+}
+
+#ifdef __SSE2__
+
+namespace
+{
+// 4 lanes of 'segmentsOverlap', as all-ones/all-zeros masks
+inline __m128i segmentsOverlap4(__m128i a_left, __m128i a_right, __m128i b_left, __m128i b_right)
+{
+  auto const swapped = _mm_cmpgt_epi32(a_left, b_left);
+  auto const ifSwapped = _mm_cmplt_epi32(a_left, b_right);
+  auto const ifNotSwapped = _mm_cmplt_epi32(b_left, a_right);
+  return _mm_or_si128(_mm_and_si128(swapped, ifSwapped), _mm_andnot_si128(swapped, ifNotSwapped));
+}
+}
+
+uint64_t overlapMask(IntBox query, const int* x1, const int* y1, const int* x2, const int* y2, int count)
+{
+  assert(count <= 64);
+
+  auto const qx1 = _mm_set1_epi32(query.pos.x);
+  auto const qy1 = _mm_set1_epi32(query.pos.y);
+  auto const qx2 = _mm_set1_epi32(query.pos.x + query.size.width);
+  auto const qy2 = _mm_set1_epi32(query.pos.y + query.size.height);
+
+  uint64_t r = 0;
+  int i = 0;
+
+  for(; i + 4 <= count; i += 4)
+  {
+    auto const bx1 = _mm_loadu_si128((const __m128i*)(x1 + i));
+    auto const by1 = _mm_loadu_si128((const __m128i*)(y1 + i));
+    auto const bx2 = _mm_loadu_si128((const __m128i*)(x2 + i));
+    auto const by2 = _mm_loadu_si128((const __m128i*)(y2 + i));
+
+    auto const hits = _mm_and_si128(segmentsOverlap4(bx1, bx2, qx1, qx2), segmentsOverlap4(by1, by2, qy1, qy2));
+
+    r |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(hits))) << i;
+  }
+
+  return r | scalarTail(query, x1, y1, x2, y2, i, count);
+}
+
+#else
+
+uint64_t overlapMask(IntBox query, const int* x1, const int* y1, const int* x2, const int* y2, int count)
+{
+  return overlapMaskScalar(query, x1, y1, x2, y2, count);
+}
+
+#endif
+
@@ -0,0 +1,21 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Batched box overlap test: one query box against up to 64 boxes
+// stored as separate coordinate arrays (see BodyStore).
+// Bit 'i' of the result is set iff 'overlaps(box[i], query)'.
+
+#pragma once
+
+#include <cstdint>
+#include "vec.h"
+
+// SSE2 when available, scalar otherwise (e.g asm.js)
+uint64_t overlapMask(IntBox query, const int* x1, const int* y1, const int* x2, const int* y2, int count);
+
+// reference implementation
+uint64_t overlapMaskScalar(IntBox query, const int* x1, const int* y1, const int* x2, const int* y2, int count);
+
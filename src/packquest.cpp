@@ -15,7 +15,7 @@ int main(int argc, const char* argv[])
   }
 
   auto q = loadTmxQuest(argv[1]);
-  preprocessQuest(q);
+  preprocessQuest(q, 0);
   dumpQuest(q, argv[2]);
   return 0;
 }
@@ -6,11 +6,18 @@
  * License, or (at your option) any later version.
  */
 
+#include <algorithm> // sort
 #include <cmath> // round
+#include <limits>
 
 #include "body.h"
 #include "base/util.h"
+#include "body_store.h"
+#include "collision_groups.h"
+#include "engine/src/misc/jobs.h"
+#include "overlap_kernel.h"
 #include "physics.h"
+#include "spatial_hash.h"
 #include <vector>
 #include <memory>
 
@@ -35,17 +42,85 @@ struct Physics : IPhysics
 {
   void addBody(Body* body)
   {
-    m_bodies.push_back(body);
+    body->slot = m_store.size();
+    body->floor = {}; // might refer to another physics world
+    m_store.push(body);
+    m_handleOf.push_back(allocateHandle(body));
+    m_riders.push_back({});
+    m_carry.push_back(NullVector);
+    m_bucketOf.push_back(getBucket(body->collisionGroup, body->collidesWith));
+    m_buckets[m_bucketOf.back()].grid.insert(body->slot, m_store.box(body->slot));
+
+    // not tested yet: awake
+    m_motion.push_back({});
+    m_awakeGrid.insert(body->slot, m_store.box(body->slot));
   }
 
   void removeBody(Body* body)
   {
-    auto isItTheOne =
-      [ = ] (Body* candidate) { return candidate == body; };
-    unstableRemove(m_bodies, isItTheOne);
+    if(!isRegistered(body))
+      return;
+
+    auto const i = body->slot;
+
+    // same ordering as 'unstableRemove': the last body takes the free slot
+    auto const last = m_store.size() - 1;
+
+    // The riders' floor handles now resolve to null.
+    // Leave the floor we rest on, so its riders only name live bodies.
+    setFloor(body, nullptr);
+    freeHandle(m_handleOf[i]);
+
+    m_buckets[m_bucketOf[i]].grid.remove(i);
+
+    if(!m_motion[i].resting)
+      m_awakeGrid.remove(i);
+
+    if(i != last)
+    {
+      m_buckets[m_bucketOf[last]].grid.rename(last, i);
+      m_bucketOf[i] = m_bucketOf[last];
+
+      if(!m_motion[last].resting)
+        m_awakeGrid.rename(last, i);
+
+      m_store.copy(i, last);
+      m_store.handles[i]->slot = i;
+      m_handleOf[i] = m_handleOf[last];
+      m_riders[i] = move(m_riders[last]);
+      m_carry[i] = m_carry[last];
+      m_motion[i] = move(m_motion[last]);
+
+      // The pair results kept by the other bodies still name the removed
+      // body 'i', and don't name 'i' for the pairs of the moved one.
+      // They're only trusted between two resting bodies: keeping the moved
+      // one awake until it has fresh results makes them harmless.
+      // Pairs naming 'last' are skipped until that slot is used again,
+      // by a body that starts awake.
+      wake(i);
+    }
+
+    m_store.pop();
+    m_handleOf.pop_back();
+    m_riders.pop_back();
+    m_carry.pop_back();
+    m_motion.pop_back();
+    m_bucketOf.pop_back();
+    body->slot = -1;
   }
 
   bool moveBody(Body* body, Vector delta)
+  {
+    // the body might have been teleported since it was last synced
+    sync(body);
+
+    if(m_fixedPoint)
+      delta = toFixed(body, delta);
+
+    return displace(body, delta);
+  }
+
+  bool displace(Body* body, Vector delta)
   {
     auto frect = body->getFBox();
     frect.pos += delta;
@@ -65,6 +140,7 @@ struct Physics : IPhysics
         pushOthers(body, irect, delta);
 
       body->pos = frect.pos;
+      sync(body);
       // assert(!getSolidBodyInBox(body->getBox(), -1, body));
     }
 
@@ -74,24 +150,114 @@ struct Physics : IPhysics
       auto feet = body->getBox();
       feet.size.height = 16;
       feet.pos.y -= feet.size.height;
-      body->floor = getSolidBodyInBox(feet, -1, body);
+      setFloor(body, getSolidBodyInBox(feet, -1, body));
     }
 
     return !blocked;
   }
 
+  void syncBody(Body* body)
+  {
+    sync(body);
+  }
+
+  Sweep sweepBody(Body* body, Vector delta)
+  {
+    // the body might have been teleported since it was last synced
+    sync(body);
+
+    if(m_fixedPoint)
+      delta = toFixed(body, delta);
+
+    auto const start = body->getBox();
+
+    auto frect = body->getFBox();
+    frect.pos += delta;
+
+    auto const end = roundBox(frect);
+    auto const move = end.pos - start.pos;
+
+    auto const hit = findFirstObstacle(body, start, move);
+
+    Sweep r;
+
+    if(hit.time >= 1 && displace(body, delta))
+      return r;
+
+    // Walk back from the time of impact, in whole PRECISION units
+    // along the major axis, until we find a free position.
+    // Only rounding errors need this, so give up quickly
+    // (e.g the body is stuck inside an obstacle we ignored).
+    auto const steps = max(abs(move.x), abs(move.y));
+    auto k = min(int(hit.time * steps), steps);
+
+    for(int retry = 0;; ++retry)
+    {
+      if(retry >= 4)
+        k = 0;
+
+      auto const ratio = steps ? double(k) / steps : 0.0;
+      auto const partial = Vector(int(move.x * ratio), int(move.y * ratio)) * (1.0 / PRECISION);
+
+      auto dest = body->getFBox();
+      dest.pos += partial;
+
+      if(k == 0 || !isSolid(body, roundBox(dest)))
+      {
+        displace(body, partial);
+        break;
+      }
+
+      --k;
+    }
+
+    r.fraction = steps ? float(k) / steps : 0;
+
+    if(hit.axis == 0)
+      r.normal = Vector(move.x > 0 ? -1 : 1, 0);
+    else if(hit.axis == 1)
+      r.normal = Vector(0, move.y > 0 ? -1 : 1);
+
+    r.blocker = hit.body;
+
+    if(r.blocker)
+      collideBodies(*body, *r.blocker);
+
+    return r;
+  }
+
   void pushOthers(Body* body, IntBox rect, Vector delta)
   {
+    // Same order as a scan of all the bodies: by slot.
+    // Work on copies, as moving bodies modifies the lists.
+    vector<Body*> riders;
+
+    if(isRegistered(body))
+    {
+      for(auto rider : m_riders[body->slot])
+        if(auto otherBody = resolve(rider))
+          riders.push_back(otherBody);
+    }
+
+    sort(riders.begin(), riders.end(), &bySlot);
+
     // move stacked bodies
-    for(auto otherBody : m_bodies)
+    for(auto otherBody : riders)
     {
-      if(otherBody->floor == body)
+      if(resolve(otherBody->floor) == body)
         moveBody(otherBody, delta);
     }
 
+    vector<Body*> candidates;
+
+    auto onCandidate = [&] (int i) { candidates.push_back(m_store.handles[i]); };
+    queryAll(rect, onCandidate);
+
+    sort(candidates.begin(), candidates.end(), &bySlot);
+
     // push potential non-solid bodies
-    for(auto other : m_bodies)
-      if(other != body && overlaps(rect, other->getBox()))
+    for(auto other : candidates)
+      if(other != body && overlaps(rect, m_store.box(other->slot)))
         moveBody(other, delta);
   }
 
@@ -100,7 +266,10 @@ struct Physics : IPhysics
     if(getSolidBodyInBox(rect, except->collidesWith, except))
       return true;
 
-    if(m_isSolid(rect))
+    if(m_edifice.isBoxSolid(rect))
+      return true;
+
+    if(blocksHazards(except->collidesWith) && m_attributes[TILE_HAZARD].isBoxSolid(toHazardTest(rect)))
       return true;
 
     return false;
@@ -108,19 +277,80 @@ struct Physics : IPhysics
 
   void checkForOverlaps()
   {
-    for(auto p : allPairs((int)m_bodies.size()))
+    auto const N = m_store.size();
+
+    // some bodies get moved without going through 'moveBody'
+    for(int i = 0; i < N; ++i)
+      sync(i);
+
+    classifyBodies();
+
+    if(m_deferred)
     {
-      auto& me = *m_bodies[p.first];
-      auto& other = *m_bodies[p.second];
+      detectContacts();
+      dispatchContacts();
+      return;
+    }
 
-      auto rect = me.getBox();
-      auto otherBox = other.getBox();
+    // Report the same pairs, in the same order, as a brute-force scan
+    // of 'allPairs' would: (i, j) with i < j, sorted lexicographically.
+    // Candidates for 'i' are gathered before its collision handlers run.
+    for(int i = 0; i < N; ++i)
+    {
+      auto& me = *m_store.handles[i];
+      auto const box = m_store.box(i);
 
-      if(overlaps(rect, otherBox))
-        collideBodies(me, other);
+      auto onlyAwake = m_motion[i].resting;
+      auto const wakeups = m_wakeups;
+
+      gatherCandidates(i, box, onlyAwake, 0, m_candidates);
+
+      int nextJ = 0; // pairs (i, j < nextJ) are done
+      int k = 0;
+
+      for(;;)
+      {
+        // A handler woke up a body we might have skipped:
+        // fall back to all the candidates for the remaining pairs.
+        if(onlyAwake && m_wakeups != wakeups)
+        {
+          onlyAwake = false;
+          gatherCandidates(i, box, false, nextJ, m_candidates);
+          k = 0;
+        }
+
+        if(k >= (int)m_candidates.size())
+          break;
+
+        auto const j = m_candidates[k++];
+        nextJ = j + 1;
+
+        // handlers might move 'me': re-read its box each time
+        if(pairOverlaps(i, j, m_stats))
+        {
+          m_motion[i].foundPairs.push_back(j);
+          collideBodies(me, *m_store.handles[j]);
+        }
+      }
     }
   }
 
+  PhysicsStats getStats() const
+  {
+    return m_stats;
+  }
+
+  void setDeferredContacts(bool deferred, JobSystem* jobs)
+  {
+    m_deferred = deferred;
+    m_jobs = jobs ? jobs : &getJobSystem();
+  }
+
+  void setFixedPoint(bool enabled)
+  {
+    m_fixedPoint = enabled;
+  }
+
   void collideBodies(Body& me, Body& other)
   {
     if(other.collidesWith & me.collisionGroup)
@@ -130,41 +360,999 @@ struct Physics : IPhysics
       me.onCollision(&other);
   }
 
-  void setEdifice(function<bool(IntBox)> edifice)
+  void setEdifice(SolidityMap edifice)
+  {
+    m_edifice = move(edifice);
+  }
+
+  void setTileAttributes(Matrix2<int> const& attributes)
+  {
+    for(int i = 0; i < TILE_ATTRIBUTE_COUNT; ++i)
+      m_attributes[i] = SolidityMap(attributes, Vector2i(0, 0), 1 << i);
+  }
+
+  // hazard tiles (spikes) are solid walls
+  static bool blocksHazards(int collidesWith)
+  {
+    return collidesWith & CG_WALLS;
+  }
+
+  // top of the hazard of a tile, from the bottom of the tile
+  static int hazardTop()
+  {
+    return int(HAZARD_HEIGHT * PRECISION);
+  }
+
+  static IntBox getHazardBox(int col, int row)
+  {
+    return IntBox(col * PRECISION, row * PRECISION, PRECISION, hazardTop());
+  }
+
+  // A tile is touched by a box whose bottom is below the tile top
+  // (see SolidityMap::isBoxSolid). Raising the bottom of 'box' by the gap
+  // above the hazards makes the tile test follow their actual height.
+  static IntBox toHazardTest(IntBox box)
+  {
+    auto const gap = PRECISION - hazardTop();
+    box.pos.y += gap;
+    box.size.height -= gap;
+    return box;
+  }
+
+  bool findTile(IntBox box, TileAttribute attribute, Vector2i* cell) const
   {
-    m_isSolid = edifice;
+    auto& map = m_attributes[attribute];
+
+    if(attribute == TILE_HAZARD)
+      box = toHazardTest(box);
+
+    if(!map.isBoxSolid(box))
+      return false;
+
+    if(cell)
+    {
+      bool found = false;
+
+      auto onTile = [&] (int col, int row)
+        {
+          if(!found)
+            *cell = Vector2i(col, row);
+
+          found = true;
+        };
+
+      map.scanSolidTiles(box, onTile);
+    }
+
+    return true;
   }
 
   Body* getBodiesInBox(IntBox myBox, int collisionGroup, bool onlySolid, const Body* except) const
   {
-    for(auto& body : m_bodies)
+    // same result as a linear scan: the matching body with the lowest slot
+    Body* r = nullptr;
+
+    if(m_store.size() <= LINEAR_SCAN_MAX)
+    {
+      auto onOverlap = [&] (int i)
+        {
+          if(!isMatch(i, myBox, collisionGroup, onlySolid, except))
+            return false;
+
+          r = m_store.handles[i];
+          return true;
+        };
+
+      scanStore(myBox, onOverlap);
+      return r;
+    }
+
+    auto onCandidate = [&] (int i)
+      {
+        if(r && r->slot < i)
+          return;
+
+        if(isMatch(i, myBox, collisionGroup, onlySolid, except))
+          r = m_store.handles[i];
+      };
+
+    queryGroups(myBox, collisionGroup, onCandidate);
+
+    return r;
+  }
+
+  int queryBox(IntBox myBox, int collisionGroup, Span<Body*> result, bool onlySolid, const Body* except) const
+  {
+    m_matches.clear();
+
+    auto onCandidate = [&] (int i)
+      {
+        if(isMatch(i, myBox, collisionGroup, onlySolid, except))
+          m_matches.push_back(i);
+      };
+
+    if(m_store.size() <= LINEAR_SCAN_MAX)
+    {
+      // already in slot order
+      scanStore(myBox, [&] (int i) { onCandidate(i); return false; });
+    }
+    else
+    {
+      queryGroups(myBox, collisionGroup, onCandidate);
+      sort(m_matches.begin(), m_matches.end());
+    }
+
+    int count = 0;
+
+    for(auto i : m_matches)
+    {
+      if(count >= result.len)
+        break;
+
+      result[count++] = m_store.handles[i];
+    }
+
+    return count;
+  }
+
+  RayHit raycast(Vector origin, Vector dir, float maxDist, int mask, const Body* except) const
+  {
+    RayHit r;
+    r.distance = maxDist;
+
+    auto const length = sqrt(double(dir.x) * dir.x + double(dir.y) * dir.y);
+
+    if(length == 0)
+      return r;
+
+    Ray ray;
+    ray.ox = origin.x;
+    ray.oy = origin.y;
+    ray.ux = dir.x / length;
+    ray.uy = dir.y / length;
+
+    // the bodies can't be hit beyond the first tile
+    castRayOnTiles(ray, blocksHazards(mask), r);
+    castRayOnBodies(ray, mask, except, r);
+
+    return r;
+  }
+
+private:
+  struct Ray
+  {
+    double ox, oy; // origin
+    double ux, uy; // unit direction
+  };
+
+  // DDA over the tile grid (tiles are 1x1 units)
+  void castRayOnTiles(Ray const& ray, bool hitHazards, RayHit& r) const
+  {
+    auto const inf = numeric_limits<double>::infinity();
+
+    int col = (int)floor(ray.ox);
+    int row = (int)floor(ray.oy);
+
+    auto const stepX = ray.ux > 0 ? 1 : -1;
+    auto const stepY = ray.uy > 0 ? 1 : -1;
+
+    // distance along the ray to the next vertical/horizontal tile border
+    auto nextX = ray.ux == 0 ? inf : (ray.ux > 0 ? col + 1 - ray.ox : ray.ox - col) / abs(ray.ux);
+    auto nextY = ray.uy == 0 ? inf : (ray.uy > 0 ? row + 1 - ray.oy : ray.oy - row) / abs(ray.uy);
+
+    auto const deltaX = ray.ux == 0 ? inf : 1.0 / abs(ray.ux);
+    auto const deltaY = ray.uy == 0 ? inf : 1.0 / abs(ray.uy);
+
+    // beyond the maps, no tile is solid: a ray can't go on forever
+    auto const limit = min(double(r.distance), rayLeavesTiles(ray));
+
+    double dist = 0;
+    auto normal = NullVector;
+
+    while(dist <= limit)
     {
-      if(onlySolid && !body->solid)
+      if(m_edifice.isTileSolid(col, row))
+      {
+        r.hit = true;
+        r.distance = dist;
+        r.normal = normal;
+        r.body = nullptr;
+        return;
+      }
+
+      // the ray might cross the gap above the hazard
+      if(hitHazards && m_attributes[TILE_HAZARD].isTileSolid(col, row))
+      {
+        double hazardDist;
+        Vector hazardNormal;
+
+        if(rayEntersBox(ray, getHazardBox(col, row), hazardDist, hazardNormal) && hazardDist <= r.distance)
+        {
+          r.hit = true;
+          r.distance = hazardDist;
+          r.normal = hazardNormal;
+          r.body = nullptr;
+          return;
+        }
+      }
+
+      if(nextX < nextY)
+      {
+        dist = nextX;
+        nextX += deltaX;
+        col += stepX;
+        normal = Vector(-stepX, 0);
+      }
+      else
+      {
+        dist = nextY;
+        nextY += deltaY;
+        row += stepY;
+        normal = Vector(0, -stepY);
+      }
+    }
+  }
+
+  // Walks the ray in chunks of one grid cell, so long rays
+  // don't query the whole world at once.
+  void castRayOnBodies(Ray const& ray, int mask, const Body* except, RayHit& r) const
+  {
+    auto const chunk = double(SpatialHash::CELL_SIZE) / PRECISION;
+
+    // no body was ever seen beyond the store bounds
+    auto limit = -1.0;
+
+    if(m_store.minX <= m_store.maxX)
+    {
+      auto const k = 1.0 / PRECISION;
+      limit = rayLeaves(ray, m_store.minX * k, m_store.minY * k, m_store.maxX * k, m_store.maxY * k);
+    }
+
+    for(double start = 0; start <= min(double(r.distance), limit); start += chunk)
+    {
+      auto const end = min(start + chunk, double(r.distance));
+
+      auto const x1 = ray.ox + ray.ux * start;
+      auto const y1 = ray.oy + ray.uy * start;
+      auto const x2 = ray.ox + ray.ux * end;
+      auto const y2 = ray.oy + ray.uy * end;
+
+      IntBox segment;
+      segment.pos.x = (int)floor(min(x1, x2) * PRECISION) - 1;
+      segment.pos.y = (int)floor(min(y1, y2) * PRECISION) - 1;
+      segment.size.width = (int)ceil(abs(x2 - x1) * PRECISION) + 2;
+      segment.size.height = (int)ceil(abs(y2 - y1) * PRECISION) + 2;
+
+      auto onCandidate = [&] (int i)
+        {
+          auto const body = m_store.handles[i];
+
+          if(body == except || !(body->collisionGroup & mask))
+            return;
+
+          double dist;
+          Vector normal;
+
+          if(!rayEntersBox(ray, m_store.box(i), dist, normal))
+            return;
+
+          // on ties, the lowest slot wins (i.e registration order)
+          if(dist < r.distance || (dist == r.distance && r.body && i < r.body->slot))
+          {
+            r.hit = true;
+            r.distance = dist;
+            r.normal = normal;
+            r.body = body;
+          }
+        };
+
+      queryGroups(segment, mask, onCandidate);
+
+      // bodies met by the next chunks can't be closer
+      if(r.body && r.distance <= end)
+        break;
+    }
+  }
+
+  // distance at which the ray leaves the tiles of the edifice and of the
+  // hazards, or a negative value if it never crosses them.
+  double rayLeavesTiles(Ray const& ray) const
+  {
+    auto r = -1.0;
+
+    for(auto map : { &m_edifice, &m_attributes[TILE_HAZARD] })
+    {
+      auto const origin = map->origin();
+      auto const size = map->size();
+
+      if(size.width <= 0 || size.height <= 0)
         continue;
 
-      if(body == except)
+      r = max(r, rayLeaves(ray, origin.x, origin.y, origin.x + size.width, origin.y + size.height));
+    }
+
+    return r;
+  }
+
+  // slab test. Distance at which the ray leaves the box [x1;x2] x [y1;y2],
+  // or a negative value if it never crosses it.
+  static double rayLeaves(Ray const& ray, double x1, double y1, double x2, double y2)
+  {
+    double const origin[] = { ray.ox, ray.oy };
+    double const dir[] = { ray.ux, ray.uy };
+    double const lo[] = { x1, y1 };
+    double const hi[] = { x2, y2 };
+
+    auto enter = -numeric_limits<double>::infinity();
+    auto leave = numeric_limits<double>::infinity();
+
+    for(int a = 0; a < 2; ++a)
+    {
+      if(dir[a] == 0)
+      {
+        if(origin[a] < lo[a] || origin[a] > hi[a])
+          return -1;
+
         continue;
+      }
+
+      auto t0 = (lo[a] - origin[a]) / dir[a];
+      auto t1 = (hi[a] - origin[a]) / dir[a];
+
+      if(t0 > t1)
+        swap(t0, t1);
+
+      enter = max(enter, t0);
+      leave = min(leave, t1);
+    }
+
+    return enter > leave ? -1 : leave;
+  }
+
+  // slab test. 'dist' is the distance at which the ray enters 'box'
+  static bool rayEntersBox(Ray const& ray, IntBox box, double& dist, Vector& normal)
+  {
+    double const origin[] = { ray.ox, ray.oy };
+    double const dir[] = { ray.ux, ray.uy };
+    double const lo[] = { double(box.pos.x) / PRECISION, double(box.pos.y) / PRECISION };
+    double const hi[] = { double(box.pos.x + box.size.width) / PRECISION, double(box.pos.y + box.size.height) / PRECISION };
+
+    auto enter = -numeric_limits<double>::infinity();
+    auto leave = numeric_limits<double>::infinity();
+    int axis = -1;
+
+    for(int a = 0; a < 2; ++a)
+    {
+      if(dir[a] == 0)
+      {
+        if(origin[a] < lo[a] || origin[a] >= hi[a])
+          return false;
+
+        continue;
+      }
+
+      auto t0 = (lo[a] - origin[a]) / dir[a];
+      auto t1 = (hi[a] - origin[a]) / dir[a];
+
+      if(t0 > t1)
+        swap(t0, t1);
+
+      if(t0 > enter)
+      {
+        enter = t0;
+        axis = a;
+      }
+
+      leave = min(leave, t1);
+    }
+
+    if(enter >= leave || leave <= 0)
+      return false;
 
-      if(!(body->collisionGroup & collisionGroup))
+    if(enter <= 0)
+    {
+      // the origin is inside the box
+      dist = 0;
+      normal = NullVector;
+      return true;
+    }
+
+    dist = enter;
+
+    if(axis == 0)
+      normal = Vector(ray.ux > 0 ? -1 : 1, 0);
+    else
+      normal = Vector(0, ray.uy > 0 ? -1 : 1);
+
+    return true;
+  }
+
+  bool isRegistered(const Body* body) const
+  {
+    auto const i = body->slot;
+    return i >= 0 && i < m_store.size() && m_store.handles[i] == body;
+  }
+
+  void sync(Body* body)
+  {
+    if(isRegistered(body))
+      sync(body->slot);
+  }
+
+  void sync(int i)
+  {
+    if(m_store.sync(i))
+    {
+      auto const bucket = m_bucketOf[i];
+
+      if(m_store.groups[i] != m_buckets[bucket].group || m_store.masks[i] != m_buckets[bucket].mask)
+      {
+        m_buckets[bucket].grid.remove(i);
+        m_bucketOf[i] = VOLATILE;
+        m_buckets[VOLATILE].grid.insert(i, m_store.box(i));
+      }
+      else
+      {
+        m_buckets[bucket].grid.update(i, m_store.box(i));
+      }
+
+      wake(i);
+    }
+
+    if(m_fixedPoint)
+      m_store.handles[i]->pos = Vector(m_store.x1[i], m_store.y1[i]) * (1.0f / PRECISION);
+  }
+
+  // Multiples of 1/PRECISION are exact in float (up to 2^24 PRECISION units),
+  // and so are their sums: once snapped, positions never get rounded again.
+  static Vector toFixed(Vector v)
+  {
+    return Vector(roundCoord(v.x), roundCoord(v.y)) * (1.0f / PRECISION);
+  }
+
+  // Rounding each move on its own would stop the bodies moving by less
+  // than half a PRECISION unit per tick (e.g a slow platform), and slow
+  // down the others. What gets rounded off is kept, and added to the
+  // next move of the same body.
+  Vector toFixed(Body* body, Vector delta)
+  {
+    if(!isRegistered(body))
+      return toFixed(delta);
+
+    auto& carry = m_carry[body->slot];
+    auto const wanted = delta + carry;
+    auto const r = toFixed(wanted);
+    carry = wanted - r;
+    return r;
+  }
+
+  // Resting bodies are the ones whose box didn't change since
+  // the previous pass. Two resting bodies don't need to be tested
+  // against each other: the previous result still holds.
+  // The awake bodies are kept in their own grid, so resting ones
+  // only need to look for awake neighbours.
+  struct Motion
+  {
+    bool moved = true; // since the start of the previous pass
+    bool hasMoved = false; // since the body was added
+    bool resting = false;
+
+    // overlapping partners j > i, found by the previous/current pass, sorted
+    vector<int> restingPairs;
+    vector<int> foundPairs;
+  };
+
+  void wake(int i)
+  {
+    auto& motion = m_motion[i];
+    motion.moved = true;
+    motion.hasMoved = true;
+
+    if(motion.resting)
+    {
+      motion.resting = false;
+      m_awakeGrid.insert(i, m_store.box(i));
+      ++m_wakeups;
+    }
+    else
+    {
+      m_awakeGrid.update(i, m_store.box(i));
+    }
+  }
+
+  void classifyBodies()
+  {
+    m_stats = {};
+
+    for(int i = 0; i < m_store.size(); ++i)
+    {
+      auto& motion = m_motion[i];
+      auto const resting = !motion.moved;
+
+      if(resting != motion.resting)
+      {
+        if(resting)
+          m_awakeGrid.remove(i);
+        else
+          m_awakeGrid.insert(i, m_store.box(i));
+
+        motion.resting = resting;
+      }
+
+      motion.moved = false;
+
+      swap(motion.restingPairs, motion.foundPairs);
+      motion.foundPairs.clear();
+
+      if(!resting)
+        ++m_stats.awakeBodies;
+      else if(motion.hasMoved)
+        ++m_stats.sleepingBodies;
+      else
+        ++m_stats.staticBodies;
+    }
+  }
+
+  // pair candidates (i, j) with j > i and j >= firstJ, sorted, without duplicates.
+  // Thread-safe.
+  void gatherCandidates(int i, IntBox box, bool onlyAwake, int firstJ, vector<int>& candidates) const
+  {
+    candidates.clear();
+
+    auto const minJ = max(i + 1, firstJ);
+
+    auto onCandidate = [&] (int j)
+      {
+        if(j >= minJ)
+          candidates.push_back(j);
+      };
+
+    if(onlyAwake)
+    {
+      m_awakeGrid.scan(box, onCandidate);
+
+      // might still name the slot freed by 'removeBody'
+      for(auto j : m_motion[i].restingPairs)
+        if(j < m_store.size())
+          onCandidate(j);
+    }
+    else
+    {
+      // only the buckets that can interact with 'i'
+      auto const me = m_store.handles[i];
+
+      for(auto& bucket : m_buckets)
+        if((bucket.group & me->collidesWith) || (bucket.mask & me->collisionGroup))
+          bucket.grid.scan(box, onCandidate);
+    }
+
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+  }
+
+  bool pairOverlaps(int i, int j, PhysicsStats& stats) const
+  {
+    auto& motion = m_motion[i];
+
+    if(motion.resting && m_motion[j].resting)
+    {
+      ++stats.skippedPairs;
+      return binary_search(motion.restingPairs.begin(), motion.restingPairs.end(), j);
+    }
+
+    ++stats.testedPairs;
+    return overlaps(m_store.box(i), m_store.box(j));
+  }
+
+  struct Contact
+  {
+    int i, j; // slots, i < j
+  };
+
+  // fills 'm_contacts' with the same pairs, in the same order,
+  // as the immediate mode of 'checkForOverlaps' would report them.
+  void detectContacts()
+  {
+    auto const N = m_store.size();
+
+    // small worlds stay on the calling thread
+    auto const grain = 256;
+    auto const numParts = max(1, (N + grain - 1) / grain);
+
+    m_contactParts.resize(numParts);
+    m_partStats.assign(numParts, {});
+
+    auto detectPart = [this] (int first, int last)
+      {
+        auto const part = first / grain;
+        detectContacts(first, last, m_contactParts[part], m_partStats[part]);
+      };
+
+    m_jobs->parallelFor(N, grain, detectPart);
+
+    // the parts cover increasing slot ranges: concatenating them keeps the order
+    m_contacts.clear();
+
+    for(auto& part : m_contactParts)
+      m_contacts.insert(m_contacts.end(), part.begin(), part.end());
+
+    for(auto& stats : m_partStats)
+    {
+      m_stats.testedPairs += stats.testedPairs;
+      m_stats.skippedPairs += stats.skippedPairs;
+    }
+  }
+
+  // Only writes to the slots in [first;last[ (and to its arguments):
+  // safe to call from several threads on disjoint ranges.
+  void detectContacts(int first, int last, vector<Contact>& contacts, PhysicsStats& stats)
+  {
+    contacts.clear();
+
+    vector<int> candidates;
+
+    for(int i = first; i < last; ++i)
+    {
+      gatherCandidates(i, m_store.box(i), m_motion[i].resting, 0, candidates);
+
+      for(auto j : candidates)
+      {
+        if(pairOverlaps(i, j, stats))
+        {
+          m_motion[i].foundPairs.push_back(j);
+          contacts.push_back({ i, j });
+        }
+      }
+    }
+  }
+
+  void dispatchContacts()
+  {
+    // resolve the slots before running any handler:
+    // removing a body moves the last one into its slot.
+    m_contactBodies.clear();
+
+    for(auto& contact : m_contacts)
+      m_contactBodies.push_back({ m_store.handles[contact.i], m_store.handles[contact.j] });
+
+    for(auto& contact : m_contactBodies)
+    {
+      auto& me = *contact.first;
+      auto& other = *contact.second;
+
+      // handlers might have moved or removed them since the detection
+      if(!isRegistered(&me) || !isRegistered(&other))
         continue;
 
-      auto rect = body->getBox();
+      if(overlaps(m_store.box(me.slot), m_store.box(other.slot)))
+        collideBodies(me, other);
+    }
+  }
 
-      if(overlaps(rect, myBox))
-        return body;
+  // Bodies are bucketed by collision masks, each bucket having its own grid,
+  // so masked queries only visit the relevant buckets.
+  // Bodies whose masks changed since they were added end up in the
+  // 'volatile' bucket, which matches everything.
+  // The change is noticed on the next sync of the body.
+  struct Bucket
+  {
+    Bucket(int group_, int mask_) : group(group_), mask(mask_) {}
+
+    int group; // Body::collisionGroup of the bodies inside
+    int mask; // Body::collidesWith of the bodies inside
+    SpatialHash grid;
+  };
+
+  static auto const VOLATILE = 0;
+
+  int getBucket(int group, int mask)
+  {
+    if(m_buckets.empty())
+      m_buckets.push_back(Bucket(CG_ALL, CG_ALL));
+
+    for(int i = 1; i < (int)m_buckets.size(); ++i)
+      if(m_buckets[i].group == group && m_buckets[i].mask == mask)
+        return i;
+
+    m_buckets.push_back(Bucket(group, mask));
+    return (int)m_buckets.size() - 1;
+  }
+
+  // calls 'onCandidate(slot)' once for each body whose box might overlap 'box',
+  // skipping the buckets whose group doesn't match 'groupMask'.
+  template<typename Lambda>
+  void queryGroups(IntBox box, int groupMask, Lambda onCandidate) const
+  {
+    for(auto& bucket : m_buckets)
+      if(bucket.group & groupMask)
+        bucket.grid.query(box, onCandidate);
+  }
+
+  // Up to this many bodies, scanning the whole store with the batched
+  // overlap test is cheaper than visiting the cells of the buckets.
+  static auto const LINEAR_SCAN_MAX = 256;
+
+  // calls 'onOverlap(slot)' in slot order, for each body whose box overlaps 'box',
+  // until it returns true.
+  template<typename Lambda>
+  void scanStore(IntBox box, Lambda onOverlap) const
+  {
+    auto const N = m_store.size();
+
+    for(int first = 0; first < N; first += 64)
+    {
+      auto mask = overlapMask(box, &m_store.x1[first], &m_store.y1[first], &m_store.x2[first], &m_store.y2[first], min(64, N - first));
+
+      for(; mask; mask &= mask - 1)
+      {
+        if(onOverlap(first + __builtin_ctzll(mask)))
+          return;
+      }
     }
+  }
 
-    return nullptr;
+  // including the bodies that belong to no group
+  template<typename Lambda>
+  void queryAll(IntBox box, Lambda onCandidate) const
+  {
+    for(auto& bucket : m_buckets)
+      bucket.grid.query(box, onCandidate);
   }
 
-private:
   Body* getSolidBodyInBox(IntBox myBox, int collisionGroup, const Body* except) const
   {
     return getBodiesInBox(myBox, collisionGroup, true, except);
   }
 
-  vector<Body*> m_bodies;
-  function<bool(IntBox)> m_isSolid;
+  static bool bySlot(const Body* a, const Body* b)
+  {
+    return a->slot < b->slot;
+  }
+
+  // keeps the reverse 'floor' links up to date
+  void setFloor(Body* body, Body* floor)
+  {
+    auto const floorHandle = floor ? m_handleOf[floor->slot] : BodyHandle();
+
+    if(body->floor == floorHandle)
+      return;
+
+    if(!isRegistered(body))
+    {
+      body->floor = floorHandle;
+      return;
+    }
+
+    auto const me = m_handleOf[body->slot];
+
+    if(auto previous = resolve(body->floor))
+    {
+      auto isItTheOne = [&] (BodyHandle rider) { return rider == me; };
+      unstableRemove(m_riders[previous->slot], isItTheOne);
+    }
+
+    body->floor = floorHandle;
+
+    if(floor)
+      m_riders[floor->slot].push_back(me);
+  }
+
+  Body* resolve(BodyHandle handle) const
+  {
+    if(handle.index < 0 || handle.index >= (int)m_handleSlots.size())
+      return nullptr;
+
+    auto& slot = m_handleSlots[handle.index];
+
+    if(slot.generation != handle.generation)
+      return nullptr;
+
+    return slot.body;
+  }
+
+  BodyHandle allocateHandle(Body* body)
+  {
+    int index;
+
+    if(m_freeHandles.empty())
+    {
+      index = (int)m_handleSlots.size();
+      m_handleSlots.push_back({});
+    }
+    else
+    {
+      index = m_freeHandles.back();
+      m_freeHandles.pop_back();
+    }
+
+    m_handleSlots[index].body = body;
+    return { index, m_handleSlots[index].generation };
+  }
+
+  void freeHandle(BodyHandle handle)
+  {
+    auto& slot = m_handleSlots[handle.index];
+    slot.body = nullptr;
+    slot.generation++; // the handles issued so far resolve to null
+    m_freeHandles.push_back(handle.index);
+  }
+
+  struct Impact
+  {
+    float time = 1; // >= 1 if nothing was hit
+    int axis = -1; // 0: x, 1: y
+    Body* body = nullptr;
+  };
+
+  // earliest obstacle met by 'box' when moving it by 'move'.
+  // Obstacles already overlapping the box at the start are ignored,
+  // so stuck bodies can move out.
+  Impact findFirstObstacle(Body* body, IntBox box, Vector2i move) const
+  {
+    IntBox swept;
+    swept.pos.x = min(box.pos.x, box.pos.x + move.x);
+    swept.pos.y = min(box.pos.y, box.pos.y + move.y);
+    swept.size.width = box.size.width + abs(move.x);
+    swept.size.height = box.size.height + abs(move.y);
+
+    Impact r;
+
+    auto test = [&] (IntBox obstacle, Body* obstacleBody)
+      {
+        float time;
+        int axis;
+
+        if(timeOfImpact(box, move, obstacle, time, axis) && time < r.time)
+        {
+          r.time = time;
+          r.axis = axis;
+          r.body = obstacleBody;
+        }
+      };
+
+    auto onCandidate = [&] (int i)
+      {
+        if(isMatch(i, swept, body->collidesWith, true, body))
+          test(m_store.box(i), m_store.handles[i]);
+      };
+
+    queryGroups(swept, body->collidesWith, onCandidate);
+
+    // a tile is touched as soon as the box reaches its bottom-left corner
+    // (see SolidityMap::isBoxSolid), hence the extra unit.
+    auto onTile = [&] (int col, int row)
+      {
+        test(IntBox(col * PRECISION - 1, row * PRECISION - 1, PRECISION + 1, PRECISION + 1), nullptr);
+      };
+
+    m_edifice.scanSolidTiles(swept, onTile);
+
+    auto onHazard = [&] (int col, int row)
+      {
+        test(IntBox(col * PRECISION - 1, row * PRECISION - 1, PRECISION + 1, hazardTop() + 1), nullptr);
+      };
+
+    if(blocksHazards(body->collidesWith))
+      m_attributes[TILE_HAZARD].scanSolidTiles(swept, onHazard);
+
+    return r;
+  }
+
+  // earliest time in ]0;1[ at which 'box', moving by 'move', starts overlapping 'obstacle'.
+  static bool timeOfImpact(IntBox box, Vector2i move, IntBox obstacle, float& time, int& axis)
+  {
+    int const boxPos[] = { box.pos.x, box.pos.y };
+    int const boxSize[] = { box.size.width, box.size.height };
+    int const obstaclePos[] = { obstacle.pos.x, obstacle.pos.y };
+    int const obstacleSize[] = { obstacle.size.width, obstacle.size.height };
+    int const delta[] = { move.x, move.y };
+
+    float enter = 0;
+    float leave = 1;
+    axis = -1;
+
+    for(int a = 0; a < 2; ++a)
+    {
+      // on this axis, the intervals overlap when the displacement is
+      // strictly inside ]lo;hi[
+      auto const lo = obstaclePos[a] - (boxPos[a] + boxSize[a]);
+      auto const hi = obstaclePos[a] + obstacleSize[a] - boxPos[a];
+
+      if(delta[a] == 0)
+      {
+        if(lo >= 0 || hi <= 0)
+          return false;
+
+        continue;
+      }
+
+      auto t0 = float(lo) / delta[a];
+      auto t1 = float(hi) / delta[a];
+
+      if(t0 > t1)
+        swap(t0, t1);
+
+      // on corner contacts, the first axis (x) wins
+      if(axis == -1 ? t0 >= enter : t0 > enter)
+      {
+        enter = t0;
+        axis = a;
+      }
+
+      leave = min(leave, t1);
+    }
+
+    if(enter >= leave)
+      return false;
+
+    if(axis == -1)
+      return false; // already overlapping at the start
+
+    time = enter;
+    return true;
+  }
+
+  // boxes and flags come from the store: no body is dereferenced
+  bool isMatch(int i, IntBox myBox, int collisionGroup, bool onlySolid, const Body* except) const
+  {
+    if(!overlaps(m_store.box(i), myBox))
+      return false;
+
+    if(onlySolid && !m_store.solid[i])
+      return false;
+
+    if(m_store.handles[i] == except)
+      return false;
+
+    if(!(m_store.groups[i] & collisionGroup))
+      return false;
+
+    return true;
+  }
+
+  BodyStore m_store;
+  SolidityMap m_edifice;
+  SolidityMap m_attributes[TILE_ATTRIBUTE_COUNT]; // one plane per TileAttribute
+
+  // Stable handles: unlike the slots, a handle index isn't reused by
+  // another body before its generation changes (see 'BodyHandle').
+  struct HandleSlot
+  {
+    Body* body = nullptr; // null: free
+    uint32_t generation = 1; // a default handle never resolves
+  };
+
+  vector<HandleSlot> m_handleSlots;
+  vector<int> m_freeHandles;
+  vector<BodyHandle> m_handleOf; // indexed by slot
+
+  // bodies resting on each body (i.e reverse 'floor' links), indexed by slot
+  vector<vector<BodyHandle>> m_riders;
+
+  // fixed-point mode: what was rounded off the moves of each body (see 'toFixed'), indexed by slot
+  vector<Vector> m_carry;
+
+  // broadphase, indexed by body slot
+  vector<Bucket> m_buckets;
+  vector<int> m_bucketOf; // indexed by slot
+  vector<int> m_candidates;
+
+  // resting bodies (see 'Motion'), indexed by slot
+  vector<Motion> m_motion;
+  SpatialHash m_awakeGrid; // only has the bodies which aren't resting
+  int m_wakeups = 0; // number of resting bodies woken up so far
+  PhysicsStats m_stats;
+  mutable vector<int> m_matches;
+
+  bool m_fixedPoint = false;
+
+  // deferred contacts (see 'setDeferredContacts')
+  bool m_deferred = false;
+  JobSystem* m_jobs = nullptr;
+  vector<vector<Contact>> m_contactParts; // one per slice of bodies
+  vector<PhysicsStats> m_partStats;
+  vector<Contact> m_contacts;
+  vector<pair<Body*, Body*>> m_contactBodies;
 };
 
 unique_ptr<IPhysics> createPhysics()
@@ -10,6 +10,20 @@
 
 #include "body.h"
 #include "physics_probe.h"
+#include "solidity_map.h"
+
+struct JobSystem;
+
+// about the last 'checkForOverlaps'
+struct PhysicsStats
+{
+  int staticBodies = 0; // never moved since they were added
+  int sleepingBodies = 0; // didn't move since the previous pass
+  int awakeBodies = 0;
+
+  int testedPairs = 0;
+  int skippedPairs = 0; // both bodies at rest: the previous result was reused
+};
 
 struct IPhysics : IPhysicsProbe
 {
@@ -18,7 +32,31 @@ struct IPhysics : IPhysicsProbe
   virtual void addBody(Body* body) = 0;
   virtual void removeBody(Body* body) = 0;
   virtual void checkForOverlaps() = 0;
-  virtual void setEdifice(function<bool(IntBox)> isSolid) = 0;
+
+  // By default, 'checkForOverlaps' invokes the collision handlers as soon
+  // as each contact is found (the reference behaviour).
+  // In deferred mode, contacts are collected first (by slices of bodies,
+  // spread over the workers of 'jobs'), then dispatched in the same order.
+  // Contacts are then found from the positions at the start of the pass.
+  // 'jobs' defaults to the process-wide job system (see getJobSystem).
+  virtual void setDeferredContacts(bool deferred, JobSystem* jobs = nullptr) = 0;
+
+  virtual PhysicsStats getStats() const = 0;
+
+  // In fixed-point mode, positions and displacements are kept in whole
+  // PRECISION units: 'Body::pos' becomes an exact float view of the
+  // integer position, and no result depends on float rounding.
+  // Bodies teleported by writing 'pos' directly are snapped to the grid.
+  // What a move loses to rounding is carried over to the next move of the
+  // same body: slow bodies still move, by one unit every few moves.
+  virtual void setFixedPoint(bool enabled) = 0;
+
+  // static geometry (i.e the tiles), owned by the physics
+  virtual void setEdifice(SolidityMap edifice) = 0;
+
+  // TileAttribute flags of each tile (see 'findTile'), aligned on tile (0;0).
+  // Hazard tiles are solid for the bodies colliding with CG_WALLS.
+  virtual void setTileAttributes(Matrix2<int> const& attributes) = 0;
 };
 
 #include <memory>
@@ -8,12 +8,59 @@
 
 #pragma once
 
+#include "base/span.h"
 #include "body.h"
+#include "tile_attribute.h"
+
+// result of a swept move
+struct Sweep
+{
+  float fraction = 1.0f; // part of the requested delta actually travelled, in [0;1]
+  Vector normal = NullVector; // contact normal (null if nothing was hit)
+  Body* blocker = nullptr; // the body we ran into (null for the static geometry)
+};
+
+// result of a raycast
+struct RayHit
+{
+  bool hit = false;
+  float distance = 0; // from the origin, along the ray (maxDist if nothing was hit)
+  Vector normal = NullVector; // surface normal at the hit point (null if nothing was hit)
+  Body* body = nullptr; // the body hit (null for the static geometry)
+};
 
 struct IPhysicsProbe
 {
   virtual bool moveBody(Body* body, Vector delta) = 0;
+
+  // like moveBody, but stops at the first obstacle on the way
+  // instead of only testing the destination (no tunnelling).
+  virtual Sweep sweepBody(Body* body, Vector delta) = 0;
+
   virtual bool isSolid(const Body* body, IntBox) const = 0;
+
+  // The queries see the bodies as they were when last synced.
+  // To call after writing the position, the size, 'solid', 'collisionGroup'
+  // or 'collidesWith' of a body directly, if other bodies must see the change
+  // before the body moves again, or before the next 'checkForOverlaps'.
+  virtual void syncBody(Body* body) = 0;
+
+  // the body, if it's still in this world (e.g 'Body::floor')
+  virtual Body* resolve(BodyHandle handle) const = 0;
+
+  // returns the first matching body, in registration order
   virtual Body* getBodiesInBox(IntBox myBox, int collisionGroup, bool onlySolid = false, const Body* except = nullptr) const = 0;
+
+  // writes every matching body (in registration order) into 'result'.
+  // returns the number of bodies written (at most result.len).
+  virtual int queryBox(IntBox myBox, int collisionGroup, Span<Body*> result, bool onlySolid = false, const Body* except = nullptr) const = 0;
+
+  // first obstacle met by the ray: a solid tile, or a body whose group matches 'mask'.
+  // 'dir' doesn't need to be normalized. Obstacles containing the origin are hit at distance 0.
+  virtual RayHit raycast(Vector origin, Vector dir, float maxDist, int mask, const Body* except = nullptr) const = 0;
+
+  // true if 'box' touches a tile having 'attribute' (same convention as 'isSolid').
+  // The first one found (bottom row first, then left to right) is written to 'cell'.
+  virtual bool findTile(IntBox box, TileAttribute attribute, Vector2i* cell = nullptr) const = 0;
 };
 
@@ -10,10 +10,11 @@
 // - add some display randomness to the tiles
 
 #include "quest.h"
-#include <cstdlib> // rand
+#include "preprocess_quest.h"
+#include "engine/src/misc/random.h"
 
 static
-void addRandomWidgets(Matrix2<int>& tiles)
+void addRandomWidgets(Matrix2<int>& tiles, uint32_t& seed)
 {
   auto rect = [&] (Vector2i pos, Size2i size, int tile)
     {
@@ -37,7 +38,9 @@ void addRandomWidgets(Matrix2<int>& tiles)
 
   for(int i = 0; i < (maxX * maxY) / 100; ++i)
   {
-    auto pos = Vector2i(rand() % maxX + 1, rand() % maxY + 1);
+    auto const x = pseudoRandom(seed) % maxX + 1;
+    auto const y = pseudoRandom(seed) % maxY + 1;
+    auto pos = Vector2i(x, y);
     auto size = Size2i(2, 2);
 
     if(isFull(pos + Vector2i(-1, -1), Size2i(size.width + 2, size.height + 2)))
@@ -85,15 +88,23 @@ void addBoundaryDetectors(Room& room, vector<Room> const& quest)
 {
   auto const CELL_SIZE = 16;
 
-  auto tryToConnectRoom = [&] (Vector2i delta, Vector2i margin)
+  // 'length' cells from 'delta', all leading to the same place
+  auto tryToConnectRoom = [&] (Vector2i delta, Vector2i step, int length, Vector2i margin)
     {
       auto const neighboorPos = room.pos + delta;
       auto const neighboorIdx = getRoomAt(quest, neighboorPos);
 
+      auto const span = step * (length - 1) + Vector2i(1, 1);
+
+      Room::Spawner s;
+      s.pos = toVector(delta * CELL_SIZE);
+      s.config["width"] = to_string(span.x * CELL_SIZE);
+      s.config["height"] = to_string(span.y * CELL_SIZE);
+
       if(neighboorIdx < 0)
       {
-        auto pos = toVector(delta * CELL_SIZE);
-        room.spawners.push_back({ pos, "blocker" });
+        s.name = "blocker";
+        room.spawners.push_back(s);
         return;
       }
 
@@ -101,7 +112,6 @@ void addBoundaryDetectors(Room& room, vector<Room> const& quest)
 
       auto transform = (room.pos - otherRoom.pos) * CELL_SIZE + margin;
 
-      Room::Spawner s;
       s.name = "room_boundary_detector(";
       s.name += to_string(neighboorIdx);
       s.name += ",";
@@ -109,53 +119,56 @@ void addBoundaryDetectors(Room& room, vector<Room> const& quest)
       s.name += ",";
       s.name += to_string(transform.y);
       s.name += ")";
-      s.pos = toVector(delta * CELL_SIZE);
       room.spawners.push_back(s);
     };
 
+  // Merges the contiguous cells leading to the same room (or to none)
+  // into one spawner: fewer bodies for the physics.
+  auto connectEdge = [&] (Vector2i first, Vector2i step, int count, Vector2i margin)
+    {
+      auto targetOf = [&] (int i)
+        {
+          return getRoomAt(quest, room.pos + first + step * i);
+        };
+
+      int runStart = 0;
+
+      for(int i = 1; i <= count; ++i)
+      {
+        if(i < count && targetOf(i) == targetOf(runStart))
+          continue;
+
+        tryToConnectRoom(first + step * runStart, step, i - runStart, margin);
+        runStart = i;
+      }
+    };
+
+  auto const vertical = Vector2i(0, 1);
+  auto const horizontal = Vector2i(1, 0);
+
   // left
-  for(int row = 0; row < room.size.height; ++row)
-  {
-    auto const delta = Vector2i(-1, row);
-    auto const margin = Vector2i(-1, 0);
-    tryToConnectRoom(delta, margin);
-  }
+  connectEdge(Vector2i(-1, 0), vertical, room.size.height, Vector2i(-1, 0));
 
   // right
-  for(int row = 0; row < room.size.height; ++row)
-  {
-    auto const delta = Vector2i(room.size.width, row);
-    auto const margin = Vector2i(1, 0);
-    tryToConnectRoom(delta, margin);
-  }
+  connectEdge(Vector2i(room.size.width, 0), vertical, room.size.height, Vector2i(1, 0));
 
   // bottom
-  for(int col = 0; col < room.size.width; ++col)
-  {
-    auto const delta = Vector2i(col, -1);
-    auto const margin = Vector2i(0, -2);
-    tryToConnectRoom(delta, margin);
-  }
+  connectEdge(Vector2i(0, -1), horizontal, room.size.width, Vector2i(0, -2));
 
   // top
-  for(int col = 0; col < room.size.width; ++col)
-  {
-    auto const delta = Vector2i(col, room.size.height);
-    auto const margin = Vector2i(0, 2);
-    tryToConnectRoom(delta, margin);
-  }
+  connectEdge(Vector2i(0, room.size.height), horizontal, room.size.width, Vector2i(0, 2));
 }
 
 static
-void preprocessRoom(Room& room, vector<Room> const& quest)
+void preprocessRoom(Room& room, vector<Room> const& quest, uint32_t& seed)
 {
-  addRandomWidgets(room.tiles);
+  addRandomWidgets(room.tiles, seed);
   addBoundaryDetectors(room, quest);
 }
 
-void preprocessQuest(Quest& quest)
+void preprocessQuest(Quest& quest, uint32_t seed)
 {
   for(auto& r : quest.rooms)
-    preprocessRoom(r, quest.rooms);
+    preprocessRoom(r, quest.rooms, seed);
 }
 
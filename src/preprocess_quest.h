@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
+
 struct Quest;
 
-void preprocessQuest(Quest& quest);
+// 'seed' drives the placement of the random tile widgets
+void preprocessQuest(Quest& quest, uint32_t seed);
 
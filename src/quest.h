@@ -14,6 +14,28 @@
 
 using namespace std;
 
+// The spawners of a room, compiled once at quest load (see spawn_program.h)
+struct SpawnProgram
+{
+  struct Arg
+  {
+    bool given; // false: the spawner doesn't set this parameter
+    string text;
+    int value; // 'text', already parsed
+  };
+
+  struct Op
+  {
+    int factory; // -1: unknown entity type
+    Vector pos;
+    int firstArg; // one arg per parameter of the factory (see getEntityParams)
+    int argCount;
+  };
+
+  vector<Op> ops; // one per spawner, in the same order
+  vector<Arg> args; // the arguments of all the ops
+};
+
 // A room (i.e a level)
 struct Room
 {
@@ -22,6 +44,7 @@ struct Room
   int theme = 0;
   Matrix2<int> tiles;
   Matrix2<int> tilesForDisplay;
+  Matrix2<int> attributes; // TileAttribute flags, same size as 'tiles' (or empty)
   Vector2i start;
   std::string name;
 
@@ -33,6 +56,7 @@ struct Room
   };
 
   vector<Spawner> spawners;
+  SpawnProgram program;
 };
 
 // The whole game
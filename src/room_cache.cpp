@@ -0,0 +1,90 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "room_cache.h"
+#include <cassert>
+
+RoomCache::RoomCache(IGame* game, size_t budget) :
+  m_game(game),
+  m_budget(budget)
+{
+  m_mutedGame.game = game;
+}
+
+RoomCache::~RoomCache()
+{
+  clear();
+}
+
+void RoomCache::suspend(unique_ptr<PreparedRoom> room)
+{
+  assert(!contains(room->levelIdx));
+
+  for(auto& entity : room->entities)
+    entity->game = &m_mutedGame;
+
+  room->suspended = true;
+
+  m_memoryUsage += getCost(*room);
+  m_rooms.push_front(move(room));
+
+  while(m_memoryUsage > m_budget)
+  {
+    m_memoryUsage -= getCost(*m_rooms.back());
+    m_rooms.pop_back();
+    ++evictions;
+  }
+}
+
+unique_ptr<PreparedRoom> RoomCache::take(int levelIdx)
+{
+  for(auto i = m_rooms.begin(); i != m_rooms.end(); ++i)
+  {
+    if((*i)->levelIdx != levelIdx)
+      continue;
+
+    auto room = move(*i);
+    m_rooms.erase(i);
+    m_memoryUsage -= getCost(*room);
+
+    for(auto& entity : room->entities)
+      entity->game = m_game;
+
+    ++hits;
+    return room;
+  }
+
+  ++misses;
+  return nullptr;
+}
+
+bool RoomCache::contains(int levelIdx) const
+{
+  for(auto& room : m_rooms)
+    if(room->levelIdx == levelIdx)
+      return true;
+
+  return false;
+}
+
+void RoomCache::clear()
+{
+  m_rooms.clear();
+  m_memoryUsage = 0;
+}
+
+size_t RoomCache::getCost(PreparedRoom const& room)
+{
+  // the physics of a room is small, next to its entities
+  return room.pool->memoryUsage();
+}
+
+void RoomCache::MutedGame::spawn(Entity* e)
+{
+  // nothing appears in a suspended room
+  delete e;
+}
+
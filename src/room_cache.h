@@ -0,0 +1,71 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// The rooms the player left recently, kept as they were.
+// Revisiting one of them resumes it, instead of spawning it again.
+// While suspended, the entities only see a muted game: their variable
+// observers still run, but they can't make sounds, spawn, or post events.
+
+#pragma once
+
+#include <list>
+#include <memory>
+
+#include "game.h"
+#include "room_streamer.h" // PreparedRoom
+
+using namespace std;
+
+struct RoomCache
+{
+  // 'budget': memory of the entity pools of the suspended rooms, in bytes.
+  // The least recently used rooms are dropped first.
+  RoomCache(IGame* game, size_t budget);
+  ~RoomCache();
+
+  // 'room' has been entered: its entities have a game and bodies
+  void suspend(unique_ptr<PreparedRoom> room);
+
+  // null if the room isn't in the cache
+  unique_ptr<PreparedRoom> take(int levelIdx);
+
+  bool contains(int levelIdx) const;
+  void clear();
+
+  size_t memoryUsage() const { return m_memoryUsage; }
+
+  int hits = 0;
+  int misses = 0;
+  int evictions = 0; // rooms dropped to stay within the budget
+
+private:
+  struct MutedGame : IGame
+  {
+    void textBox(char const*) override {}
+    void playSound(SOUND) override {}
+    void setAmbientLight(float) override {}
+    void stopMusic() override {}
+    void spawn(Entity* e) override;
+    IVariable* getVariable(int name) override { return game->getVariable(name); }
+    void postEvent(int, const void*, int) override {}
+    Vector getPlayerPosition() override { return game->getPlayerPosition(); }
+    void respawn() override {}
+    int random() override { return game->random(); }
+
+    IGame* game;
+  };
+
+  static size_t getCost(PreparedRoom const& room);
+
+  IGame* const m_game;
+  size_t const m_budget;
+  MutedGame m_mutedGame;
+
+  // most recently used first
+  list<unique_ptr<PreparedRoom>> m_rooms;
+  size_t m_memoryUsage = 0;
+};
+
@@ -0,0 +1,141 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "room_streamer.h"
+#include "entity_factory.h"
+#include "spawn_program.h"
+#include <algorithm> // find, remove_if
+#include <chrono>
+#include <stdexcept>
+
+unique_ptr<PreparedRoom> prepareRoom(Quest const& quest, int levelIdx)
+{
+  if(levelIdx < 0 || levelIdx >= (int)quest.rooms.size())
+    throw runtime_error("No such level");
+
+  auto& room = quest.rooms[levelIdx];
+
+  auto r = make_unique<PreparedRoom>();
+  r->levelIdx = levelIdx;
+  r->pool = make_unique<EntityPool>();
+  r->physics = createPhysics();
+
+  // replays must give the same result on every build (native, asm.js).
+  // Moves get rounded to 1/PRECISION: a body asking for less than half
+  // of that per tick only moves every few ticks (see 'setFixedPoint').
+  r->physics->setFixedPoint(true);
+
+  r->physics->setEdifice(SolidityMap(room.tiles));
+  r->physics->setTileAttributes(room.attributes);
+
+  EntityPoolScope poolScope(r->pool.get());
+
+  // avoid collisions between static entities from different rooms
+  r->entities = runSpawnProgram(room, levelIdx * 1000);
+
+  return r;
+}
+
+vector<int> getAdjacentRooms(Room const& room)
+{
+  static auto const detector = findEntityFactory("room_boundary_detector");
+  static auto const targetParam = findEntityParam(detector, "0");
+
+  auto& program = room.program;
+  vector<int> r;
+
+  for(auto& op : program.ops)
+  {
+    if(op.factory != detector)
+      continue;
+
+    auto arg = getSpawnArg(program, op, targetParam);
+
+    if(!arg)
+      continue;
+
+    auto const target = arg->value;
+
+    if(find(r.begin(), r.end(), target) == r.end())
+      r.push_back(target);
+  }
+
+  return r;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+RoomStreamer::RoomStreamer(shared_ptr<const Quest> quest) :
+  m_quest(quest)
+{
+}
+
+RoomStreamer::~RoomStreamer()
+{
+  for(auto& pending : m_pending)
+    pending.second.wait();
+
+  for(auto& abandoned : m_abandoned)
+    abandoned.wait();
+}
+
+void RoomStreamer::prefetch(vector<int> const& levels)
+{
+  // the destructor of a future from 'async' blocks until the task is done:
+  // only destroy the abandoned ones once they're ready.
+  auto isReady = [] (future<unique_ptr<PreparedRoom>> const& f)
+    {
+      return f.wait_for(chrono::seconds(0)) == future_status::ready;
+    };
+
+  m_abandoned.erase(remove_if(m_abandoned.begin(), m_abandoned.end(), isReady), m_abandoned.end());
+
+  for(auto i = m_pending.begin(); i != m_pending.end();)
+  {
+    if(find(levels.begin(), levels.end(), i->first) == levels.end())
+    {
+      if(!isReady(i->second))
+        m_abandoned.push_back(move(i->second));
+
+      i = m_pending.erase(i);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+
+  for(auto levelIdx : levels)
+  {
+    if(m_pending.count(levelIdx))
+      continue;
+
+    auto quest = m_quest;
+    m_pending[levelIdx] = async(launch::async, [quest, levelIdx] ()
+      {
+        return prepareRoom(*quest, levelIdx);
+      });
+  }
+}
+
+unique_ptr<PreparedRoom> RoomStreamer::take(int levelIdx)
+{
+  auto i = m_pending.find(levelIdx);
+
+  if(i == m_pending.end())
+  {
+    ++misses;
+    return prepareRoom(*m_quest, levelIdx);
+  }
+
+  ++hits;
+  auto future = move(i->second);
+  m_pending.erase(i);
+
+  // rethrows what the preparation threw
+  return future.get();
+}
+
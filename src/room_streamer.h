@@ -0,0 +1,64 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Background preparation of the rooms the player might enter next.
+// A prepared room has its entities constructed and its physics set up:
+// entering it only means handing them over to the game.
+
+#pragma once
+
+#include <future>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "entity.h"
+#include "entity_pool.h"
+#include "physics.h"
+#include "quest.h"
+
+using namespace std;
+
+struct PreparedRoom
+{
+  int levelIdx = -1;
+  unique_ptr<EntityPool> pool; // must outlive the entities
+  unique_ptr<IPhysics> physics;
+
+  // Not entered yet: no game, no physics, no body.
+  // Unless the room was suspended (see room_cache.h).
+  vector<unique_ptr<Entity>> entities;
+  bool suspended = false;
+};
+
+// Only reads the quest: safe to call from any thread.
+unique_ptr<PreparedRoom> prepareRoom(Quest const& quest, int levelIdx);
+
+// the targets of the boundary detectors of 'room'
+vector<int> getAdjacentRooms(Room const& room);
+
+struct RoomStreamer
+{
+  RoomStreamer(shared_ptr<const Quest> quest);
+  ~RoomStreamer(); // waits for the pending preparations
+
+  // Starts preparing these rooms in the background,
+  // and drops the ones prepared for another neighbourhood.
+  void prefetch(vector<int> const& levels);
+
+  // Waits for the room if it's still being prepared.
+  // Prepares it synchronously if it wasn't prefetched.
+  unique_ptr<PreparedRoom> take(int levelIdx);
+
+  int hits = 0;
+  int misses = 0;
+
+private:
+  shared_ptr<const Quest> const m_quest;
+  map<int, future<unique_ptr<PreparedRoom>>> m_pending;
+  vector<future<unique_ptr<PreparedRoom>>> m_abandoned; // still running
+};
+
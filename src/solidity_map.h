@@ -0,0 +1,148 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Bit-packed tile occupancy: one bit per tile, 64 tiles per word.
+// Built once per room, so box-vs-tilemap tests become a few
+// masked word tests per row instead of one branch per tile.
+
+#pragma once
+
+#include <algorithm> // min, max
+#include <cstdint>
+#include <vector>
+#include "base/geom.h"
+#include "vec.h"
+
+using namespace std;
+
+struct SolidityMap
+{
+  SolidityMap() = default;
+
+  // tiles sharing a bit with 'mask' are solid (by default: non-zero tiles).
+  // 'origin' is the position of the tile (0;0), in tile units.
+  explicit SolidityMap(Matrix2<int> const& tiles, Vector2i origin = Vector2i(0, 0), int mask = -1)
+  {
+    m_origin = origin;
+    m_size = tiles.size;
+    m_wordsPerRow = (m_size.width + 63) / 64;
+    m_bits.assign(m_wordsPerRow * m_size.height, 0);
+
+    auto onCell = [&] (int x, int y, int tile)
+      {
+        if(tile & mask)
+          m_bits[y * m_wordsPerRow + x / 64] |= uint64_t(1) << (x % 64);
+      };
+
+    tiles.scan(onCell);
+  }
+
+  Size2i size() const { return m_size; }
+  Vector2i origin() const { return m_origin; }
+
+  // 'col' and 'row' are relative to the map origin
+  bool isSolid(int col, int row) const
+  {
+    if(col < 0 || row < 0 || col >= m_size.width || row >= m_size.height)
+      return false;
+
+    return m_bits[row * m_wordsPerRow + col / 64] & (uint64_t(1) << (col % 64));
+  }
+
+  // 'col' and 'row' include the map origin
+  bool isTileSolid(int col, int row) const
+  {
+    return isSolid(col - m_origin.x, row - m_origin.y);
+  }
+
+  // 'box' is expressed in PRECISION units.
+  // Every tile touched by the box counts, including the ones
+  // only touched by its right and top edges.
+  bool isBoxSolid(IntBox box) const
+  {
+    auto const x1 = box.pos.x;
+    auto const y1 = box.pos.y;
+    auto const x2 = box.pos.x + box.size.width;
+    auto const y2 = box.pos.y + box.size.height;
+
+    auto const col1 = toTile(x1) - m_origin.x;
+    auto const row1 = toTile(y1) - m_origin.y;
+    auto const col2 = toTile(x2) - m_origin.x;
+    auto const row2 = toTile(y2) - m_origin.y;
+
+    return isRangeSolid(col1, row1, col2, row2);
+  }
+
+  // calls 'onTile(col, row)' for every solid tile touched by 'box'
+  // (see isBoxSolid). 'col' and 'row' include the map origin.
+  template<typename Lambda>
+  void scanSolidTiles(IntBox box, Lambda onTile) const
+  {
+    auto const col1 = max(toTile(box.pos.x) - m_origin.x, 0);
+    auto const row1 = max(toTile(box.pos.y) - m_origin.y, 0);
+    auto const col2 = min(toTile(box.pos.x + box.size.width) - m_origin.x, m_size.width - 1);
+    auto const row2 = min(toTile(box.pos.y + box.size.height) - m_origin.y, m_size.height - 1);
+
+    for(int row = row1; row <= row2; ++row)
+      for(int col = col1; col <= col2; ++col)
+        if(isSolid(col, row))
+          onTile(col + m_origin.x, row + m_origin.y);
+  }
+
+  // inclusive tile range, relative to the map origin.
+  // Tiles outside of the map aren't solid.
+  bool isRangeSolid(int col1, int row1, int col2, int row2) const
+  {
+    col1 = max(col1, 0);
+    row1 = max(row1, 0);
+    col2 = min(col2, m_size.width - 1);
+    row2 = min(row2, m_size.height - 1);
+
+    if(col1 > col2 || row1 > row2)
+      return false;
+
+    auto const word1 = col1 / 64;
+    auto const word2 = col2 / 64;
+    auto const firstMask = ~uint64_t(0) << (col1 % 64);
+    auto const lastMask = ~uint64_t(0) >> (63 - col2 % 64);
+
+    for(int row = row1; row <= row2; ++row)
+    {
+      auto const line = &m_bits[row * m_wordsPerRow];
+
+      if(word1 == word2)
+      {
+        if(line[word1] & firstMask & lastMask)
+          return true;
+
+        continue;
+      }
+
+      uint64_t acc = (line[word1] & firstMask) | (line[word2] & lastMask);
+
+      for(int w = word1 + 1; w < word2; ++w)
+        acc |= line[w];
+
+      if(acc)
+        return true;
+    }
+
+    return false;
+  }
+
+  // tile containing 'coord' (in PRECISION units).
+  // Rounds towards minus infinity, so negative coordinates get their own tiles.
+  static int toTile(int coord)
+  {
+    return coord >= 0 ? coord / PRECISION : -((-coord - 1) / PRECISION) - 1;
+  }
+
+private:
+  Vector2i m_origin;
+  Size2i m_size;
+  int m_wordsPerRow = 0;
+  vector<uint64_t> m_bits;
+};
@@ -0,0 +1,177 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Uniform grid broadphase, hashed into a fixed number of buckets.
+// Each registered id is stored in every cell its box touches,
+// so finding the ids near a box only visits a handful of cells.
+// Ids are expected to be small dense integers (e.g indices into a vector).
+
+#pragma once
+
+#include <vector>
+#include "vec.h"
+
+using namespace std;
+
+struct SpatialHash
+{
+  // cell side length, in PRECISION units
+  static auto const CELL_SIZE = 4 * PRECISION;
+
+  // must be a power of two
+  static auto const NUM_BUCKETS = 4096;
+
+  SpatialHash() : m_buckets(NUM_BUCKETS)
+  {
+  }
+
+  void insert(int id, IntBox box)
+  {
+    if(id >= (int)m_ranges.size())
+    {
+      m_ranges.resize(id + 1);
+      m_stamps.resize(id + 1);
+    }
+
+    auto const range = getCellRange(box);
+    m_ranges[id] = range;
+    addToCells(id, range);
+  }
+
+  void remove(int id)
+  {
+    removeFromCells(id, m_ranges[id]);
+  }
+
+  // only touches the buckets if the box crossed a cell boundary
+  void update(int id, IntBox box)
+  {
+    auto const range = getCellRange(box);
+
+    if(range == m_ranges[id])
+      return;
+
+    removeFromCells(id, m_ranges[id]);
+    m_ranges[id] = range;
+    addToCells(id, range);
+  }
+
+  // re-register an already-inserted id under another id.
+  // (used when the owner compacts its storage)
+  void rename(int oldId, int newId)
+  {
+    auto const range = m_ranges[oldId];
+
+    for(int cy = range.y1; cy <= range.y2; ++cy)
+      for(int cx = range.x1; cx <= range.x2; ++cx)
+        for(auto& id : m_buckets[bucketIndex(cx, cy)])
+          if(id == oldId)
+          {
+            id = newId;
+            break;
+          }
+
+    m_ranges[newId] = range;
+  }
+
+  // calls 'onCandidate(id)' once for each id whose cells intersect 'box'.
+  // This is conservative: candidates still need an exact overlap test.
+  template<typename Lambda>
+  void query(IntBox box, Lambda onCandidate) const
+  {
+    auto const range = getCellRange(box);
+
+    ++m_currStamp;
+
+    for(int cy = range.y1; cy <= range.y2; ++cy)
+      for(int cx = range.x1; cx <= range.x2; ++cx)
+        for(auto id : m_buckets[bucketIndex(cx, cy)])
+        {
+          if(m_stamps[id] == m_currStamp)
+            continue;
+
+          m_stamps[id] = m_currStamp;
+          onCandidate(id);
+        }
+  }
+
+  // same as 'query', but might report an id more than once.
+  // Doesn't touch any shared state, so several threads can scan at once.
+  template<typename Lambda>
+  void scan(IntBox box, Lambda onCandidate) const
+  {
+    auto const range = getCellRange(box);
+
+    for(int cy = range.y1; cy <= range.y2; ++cy)
+      for(int cx = range.x1; cx <= range.x2; ++cx)
+        for(auto id : m_buckets[bucketIndex(cx, cy)])
+          onCandidate(id);
+  }
+
+private:
+  struct CellRange
+  {
+    int x1, y1, x2, y2; // inclusive
+
+    bool operator == (CellRange const& other) const
+    {
+      return x1 == other.x1 && y1 == other.y1 && x2 == other.x2 && y2 == other.y2;
+    }
+  };
+
+  static int toCell(int coord)
+  {
+    // round towards minus infinity, so negative coordinates get their own cells
+    return coord >= 0 ? coord / CELL_SIZE : -((-coord - 1) / CELL_SIZE) - 1;
+  }
+
+  static CellRange getCellRange(IntBox box)
+  {
+    CellRange r;
+    r.x1 = toCell(box.pos.x);
+    r.y1 = toCell(box.pos.y);
+    r.x2 = toCell(box.pos.x + box.size.width);
+    r.y2 = toCell(box.pos.y + box.size.height);
+    return r;
+  }
+
+  static int bucketIndex(int cx, int cy)
+  {
+    auto const h = (unsigned)cx * 73856093u ^ (unsigned)cy * 19349663u;
+    return h & (NUM_BUCKETS - 1);
+  }
+
+  void addToCells(int id, CellRange range)
+  {
+    for(int cy = range.y1; cy <= range.y2; ++cy)
+      for(int cx = range.x1; cx <= range.x2; ++cx)
+        m_buckets[bucketIndex(cx, cy)].push_back(id);
+  }
+
+  void removeFromCells(int id, CellRange range)
+  {
+    for(int cy = range.y1; cy <= range.y2; ++cy)
+      for(int cx = range.x1; cx <= range.x2; ++cx)
+      {
+        auto& bucket = m_buckets[bucketIndex(cx, cy)];
+
+        for(auto& other : bucket)
+          if(other == id)
+          {
+            other = bucket.back();
+            bucket.pop_back();
+            break;
+          }
+      }
+  }
+
+  vector<vector<int>> m_buckets;
+  vector<CellRange> m_ranges; // indexed by id
+
+  // used to report each candidate only once per query
+  mutable vector<unsigned> m_stamps; // indexed by id
+  mutable unsigned m_currStamp = 0;
+};
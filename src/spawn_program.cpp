@@ -0,0 +1,241 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "spawn_program.h"
+#include "entity.h"
+#include "entity_factory.h"
+#include <cctype> // isalnum
+#include <cstdio> // fprintf
+#include <cstdlib> // atoi
+#include <map>
+#include <stdexcept>
+
+static
+vector<string> parseCall(string content)
+{
+  content += '\0';
+  auto stream = content.c_str();
+
+  auto head = [&] ()
+    {
+      return *stream;
+    };
+
+  auto accept = [&] (char what)
+    {
+      if(!*stream)
+        return false;
+
+      if(head() != what)
+        return false;
+
+      stream++;
+      return true;
+    };
+
+  auto expect = [&] (char what)
+    {
+      if(!accept(what))
+        throw runtime_error(string("Expected '") + what + "'");
+    };
+
+  auto parseString = [&] ()
+    {
+      string r;
+
+      while(!accept('"'))
+      {
+        char c = head();
+        accept(c);
+        r += c;
+      }
+
+      return r;
+    };
+
+  auto parseIdentifier = [&] ()
+    {
+      string r;
+
+      while(isalnum(head()) || head() == '_' || head() == '-')
+      {
+        char c = head();
+        accept(c);
+        r += c;
+      }
+
+      return r;
+    };
+
+  auto parseArgument = [&] ()
+    {
+      if(accept('"'))
+        return parseString();
+      else
+        return parseIdentifier();
+    };
+
+  vector<string> r;
+  r.push_back(parseIdentifier());
+
+  if(accept('('))
+  {
+    bool first = true;
+
+    while(!accept(')'))
+    {
+      if(!first)
+        expect(',');
+
+      r.push_back(parseArgument());
+      first = false;
+    }
+  }
+
+  return r;
+}
+
+struct CompiledConfig : IEntityConfig
+{
+  string getString(int param, string defaultValue) override
+  {
+    auto arg = getSpawnArg(*program, *op, param);
+
+    if(!arg)
+      return defaultValue;
+
+    return arg->text;
+  }
+
+  int getInt(int param, int defaultValue) override
+  {
+    auto arg = getSpawnArg(*program, *op, param);
+
+    if(!arg)
+      return defaultValue;
+
+    return arg->value;
+  }
+
+  SpawnProgram const* program;
+  SpawnProgram::Op const* op;
+};
+
+void compileSpawnPrograms(Quest& quest)
+{
+  for(int i = 0; i < (int)quest.rooms.size(); ++i)
+  {
+    auto& room = quest.rooms[i];
+    room.program = compileSpawners(room.spawners);
+
+    for(int k = 0; k < (int)room.spawners.size(); ++k)
+    {
+      if(room.program.ops[k].factory < 0)
+        fprintf(stderr, "[quest] room %d: unknown entity type: '%s'\n", i, room.spawners[k].name.c_str());
+    }
+  }
+}
+
+SpawnProgram compileSpawners(vector<Room::Spawner> const& spawners)
+{
+  SpawnProgram r;
+
+  for(auto& spawner : spawners)
+  {
+    auto words = parseCall(spawner.name);
+
+    // the arguments of the call override the config
+    auto values = spawner.config;
+
+    for(int i = 1; i < (int)words.size(); ++i)
+      values[to_string(i - 1)] = words[i];
+
+    SpawnProgram::Op op;
+    op.factory = findEntityFactory(words[0]);
+    op.pos = spawner.pos;
+    op.firstArg = (int)r.args.size();
+    op.argCount = 0;
+
+    // in the order the factory reads them
+    if(op.factory >= 0)
+    {
+      for(auto& param : getEntityParams(op.factory))
+      {
+        auto i = values.find(param);
+
+        if(i == values.end())
+          r.args.push_back({ false, "", 0 });
+        else
+          r.args.push_back({ true, i->second, atoi(i->second.c_str()) });
+
+        ++op.argCount;
+      }
+    }
+
+    r.ops.push_back(op);
+  }
+
+  return r;
+}
+
+vector<unique_ptr<Entity>> runSpawnProgram(Room const& room, int firstId)
+{
+  auto& program = room.program;
+
+  if(program.ops.size() != room.spawners.size())
+    throw runtime_error("room spawners weren't compiled");
+
+  vector<unique_ptr<Entity>> r;
+  r.reserve(program.ops.size());
+
+  CompiledConfig config;
+  config.program = &program;
+
+  int id = firstId;
+
+  for(auto& op : program.ops)
+  {
+    if(op.factory < 0)
+      throw runtime_error("unknown entity type: '" + room.spawners[id - firstId].name + "'");
+
+    config.op = &op;
+
+    auto entity = createEntity(op.factory, &config);
+    entity->id = id;
+    entity->pos = op.pos;
+    r.push_back(move(entity));
+
+    ++id;
+  }
+
+  return r;
+}
+
+SpawnProgram::Arg const* getSpawnArg(SpawnProgram const& program, SpawnProgram::Op const& op, int param)
+{
+  if(param < 0 || param >= op.argCount)
+    throw runtime_error("undeclared entity parameter: " + to_string(param));
+
+  auto& arg = program.args[op.firstArg + param];
+
+  if(!arg.given)
+    return nullptr;
+
+  return &arg;
+}
+
+SpawnProgram::Arg const* getSpawnArg(SpawnProgram const& program, SpawnProgram::Op const& op, const char* name)
+{
+  if(op.factory < 0)
+    return nullptr;
+
+  auto const param = findEntityParam(op.factory, name);
+
+  if(param < 0)
+    return nullptr;
+
+  return getSpawnArg(program, op, param);
+}
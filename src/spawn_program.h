@@ -0,0 +1,41 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Spawner names like "room_boundary_detector(3,-16,0)" are parsed,
+// and their entity types and arguments resolved, once at quest load.
+// Spawning a room then does no string work and no registry lookup:
+// the entities read their arguments by index (see IEntityConfig).
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "quest.h"
+
+using namespace std;
+
+struct Entity;
+
+// Fills the 'program' of each room, from its spawners.
+// Throws on syntax errors. Unknown entity types are reported (on stderr)
+// but only fail when spawned: a quest can refer to entities that the game
+// doesn't have yet.
+void compileSpawnPrograms(Quest& quest);
+
+SpawnProgram compileSpawners(vector<Room::Spawner> const& spawners);
+
+// the entities, in spawner order, numbered from 'firstId'.
+// Throws on unknown entity types.
+vector<unique_ptr<Entity>> runSpawnProgram(Room const& room, int firstId);
+
+// 'param': index in the parameters of the factory of 'op'.
+// Null if the spawner doesn't set it. Throws if the factory has no such parameter.
+SpawnProgram::Arg const* getSpawnArg(SpawnProgram const& program, SpawnProgram::Op const& op, int param);
+
+// same, by parameter name (see findEntityParam), for tools and tests.
+// Null if the factory has no such parameter.
+SpawnProgram::Arg const* getSpawnArg(SpawnProgram const& program, SpawnProgram::Op const& op, const char* name);
+
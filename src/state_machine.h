@@ -1,13 +1,33 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include "base/scene.h"
 #include "base/view.h"
 
 struct Quest;
 
 Scene* createSplashState(View* view);
-Scene* createPausedState(View* view, Scene* sub, Quest* quest, int room);
+Scene* createPausedState(View* view, Scene* sub, const Quest* quest, int room);
 Scene* createPlayingState(View* view);
 Scene* createEndingState(View* view);
 Scene* createPlayingStateAtLevel(View* view, int level);
 
+// Memory of the entities of the suspended rooms, in bytes.
+// Applies to the game instances created afterwards.
+void setRoomCacheBudget(size_t bytes);
+
+struct GameStats
+{
+  int roomCacheHits = 0;
+  int roomCacheMisses = 0;
+  int roomCacheEvictions = 0;
+};
+
+// all zeroes if 'scene' isn't a playing state
+GameStats getGameStats(Scene* scene);
+
+// Independent game instance, e.g for batch simulation.
+// Several instances can share the same quest, and run on different threads.
+Scene* createPlayingStateForQuest(View* view, std::shared_ptr<const Quest> quest, int level, uint32_t seed);
+
@@ -18,7 +18,7 @@
 
 struct PausedState : Scene
 {
-  PausedState(View* view_, Scene* sub_, Quest* quest_, int roomIdx) : view(view_), sub(sub_), quest(quest_), m_roomIdx(roomIdx)
+  PausedState(View* view_, Scene* sub_, const Quest* quest_, int roomIdx) : view(view_), sub(sub_), quest(quest_), m_roomIdx(roomIdx)
   {
   }
 
@@ -78,11 +78,11 @@ private:
   Toggle startButton;
   View* const view;
   std::unique_ptr<Scene> sub;
-  Quest* const quest;
+  const Quest* const quest;
   int const m_roomIdx;
 };
 
-Scene* createPausedState(View* view, Scene* sub, Quest* quest, int roomIdx)
+Scene* createPausedState(View* view, Scene* sub, const Quest* quest, int roomIdx)
 {
   return new PausedState(view, sub, quest, roomIdx);
 }
@@ -6,14 +6,18 @@
 
 // Game logic
 
+#include <algorithm> // remove
 #include <list>
 #include <map>
 
 #include "base/scene.h"
 #include "base/view.h"
 #include "base/util.h"
+#include "engine/src/misc/jobs.h"
+#include "engine/src/misc/random.h"
 
-#include "entity_factory.h"
+#include "entity_pool.h"
+#include "event_bus.h"
 #include "entities/player.h"
 #include "entities/rockman.h"
 #include "toggle.h"
@@ -23,161 +27,53 @@
 #include "quest.h"
 #include "load_quest.h"
 #include "preprocess_quest.h"
+#include "room_cache.h"
+#include "room_streamer.h"
+#include "spawn_program.h"
+#include "tile_attribute.h"
 #include "variable.h"
 #include "state_machine.h"
 
 using namespace std;
 
+static size_t g_roomCacheBudget = 1024 * 1024;
+
 static
-vector<string> parseCall(string content)
+shared_ptr<const Quest> loadAndPreprocessQuest(uint32_t seed)
 {
-  content += '\0';
-  auto stream = content.c_str();
-
-  auto head = [&] ()
-    {
-      return *stream;
-    };
-
-  auto accept = [&] (char what)
-    {
-      if(!*stream)
-        return false;
-
-      if(head() != what)
-        return false;
-
-      stream++;
-      return true;
-    };
-
-  auto expect = [&] (char what)
-    {
-      if(!accept(what))
-        throw runtime_error(string("Expected '") + what + "'");
-    };
-
-  auto parseString = [&] ()
-    {
-      string r;
-
-      while(!accept('"'))
-      {
-        char c = head();
-        accept(c);
-        r += c;
-      }
-
-      return r;
-    };
-
-  auto parseIdentifier = [&] ()
-    {
-      string r;
-
-      while(isalnum(head()) || head() == '_' || head() == '-')
-      {
-        char c = head();
-        accept(c);
-        r += c;
-      }
-
-      return r;
-    };
-
-  auto parseArgument = [&] ()
-    {
-      if(accept('"'))
-        return parseString();
-      else
-        return parseIdentifier();
-    };
-
-  vector<string> r;
-  r.push_back(parseIdentifier());
-
-  if(accept('('))
-  {
-    bool first = true;
-
-    while(!accept(')'))
-    {
-      if(!first)
-        expect(',');
-
-      r.push_back(parseArgument());
-      first = false;
-    }
-  }
-
-  return r;
+  auto quest = make_shared<Quest>(loadQuest("res/quest.json"));
+  preprocessQuest(*quest, seed);
+  compileSpawnPrograms(*quest);
+  return quest;
 }
 
-struct EntityConfigImpl : IEntityConfig
+struct GameState : Scene, private IGame
 {
-  string getString(const char* varName, string defaultValue) override
-  {
-    auto i = values.find(varName);
-
-    if(i == values.end())
-      return defaultValue;
-
-    return i->second;
-  }
-
-  int getInt(const char* varName, int defaultValue) override
+  // the seed comes from 'srand', which the engine seeds (and records)
+  GameState(View* view) :
+    GameState(view, uint32_t(rand()))
   {
-    auto i = values.find(varName);
-
-    if(i == values.end())
-      return defaultValue;
-
-    return atoi(i->second.c_str());
   }
 
-  map<string, string> values;
-};
-
-static
-void spawnEntities(Room const& room, IGame* game, int levelIdx)
-{
-  // avoid collisions between static entities from different rooms
-  int id = levelIdx * 1000;
-
-  for(auto& spawner : room.spawners)
+  // the quest preprocessing and the game share the seed
+  GameState(View* view, uint32_t seed) :
+    GameState(view, loadAndPreprocessQuest(seed), seed)
   {
-    auto words = parseCall(spawner.name);
-    auto name = words[0];
-    words.erase(words.begin());
-
-    EntityConfigImpl config;
-    config.values = spawner.config;
-
-    {
-      int i = 0;
-
-      for(auto& varValue : words)
-        config.values[to_string(i++)] = varValue;
-    }
-
-    auto entity = createEntity(name, &config);
-    entity->id = id;
-    entity->pos = spawner.pos;
-    game->spawn(entity.release());
-
-    ++id;
   }
-}
 
-struct GameState : Scene, private IGame
-{
-  GameState(View* view) :
-    m_view(view)
+  GameState(View* view, shared_ptr<const Quest> quest, uint32_t seed) :
+    m_quest(quest),
+    m_randomSeed(seed),
+    m_view(view),
+    m_streamer(quest),
+    m_roomCache(this, g_roomCacheBudget)
   {
     m_shouldLoadLevel = true;
     m_shouldLoadVars = true;
-    m_quest = loadQuest("res/quest.json");
-    preprocessQuest(m_quest);
+
+    m_events.subscribe<TouchLevelBoundary>([this] (TouchLevelBoundary const& event) { onTouchLevelBoundary(event); });
+    m_events.subscribe<SaveEvent>([this] (SaveEvent const &) { onSaveEvent(); });
+    m_events.subscribe<FinishGameEvent>([this] (FinishGameEvent const &) { m_gameFinished = true; });
   }
 
   ////////////////////////////////////////////////////////////////
@@ -186,10 +82,13 @@ struct GameState : Scene, private IGame
   Scene* tick(Control c) override
   {
     if(startButton.toggle(c.start))
-      return createPausedState(m_view, this, &m_quest, m_level);
+      return createPausedState(m_view, this, m_quest.get(), m_level);
 
     loadLevelIfNeeded();
 
+    // the entities spawned during this tick come from the room pool
+    EntityPoolScope poolScope(m_roomPool.get());
+
     m_player->think(c);
 
     updateEntities();
@@ -257,6 +156,8 @@ struct GameState : Scene, private IGame
     if(m_shouldLoadLevel)
     {
       loadLevel(m_level);
+      // the player is still waiting in 'm_spawned': 'addBody' picks up
+      // its new position when it's registered.
       m_player->pos += m_transform;
       m_shouldLoadLevel = false;
       setAmbientLight(0);
@@ -276,6 +177,16 @@ struct GameState : Scene, private IGame
 
   void updateEntities()
   {
+    auto prepare = [&] (int begin, int end)
+      {
+        for(int i = begin; i < end; ++i)
+          m_entities[i]->prepare();
+      };
+
+    // returns when every 'prepare' is done: the collision handlers, called
+    // from the serial phase below, never run concurrently with them.
+    getJobSystem().parallelFor(m_entities.size(), 32, prepare);
+
     for(auto& e : m_entities)
       e->tick();
 
@@ -285,17 +196,7 @@ struct GameState : Scene, private IGame
 
   void processEvents()
   {
-    auto events = move(m_eventQueue);
-
-    for(auto& event : events)
-    {
-      if(auto levelBoundaryEvent = event->as<TouchLevelBoundary>())
-        onTouchLevelBoundary(levelBoundaryEvent);
-      else if(event->as<SaveEvent>())
-        onSaveEvent();
-      else if(event->as<FinishGameEvent>())
-        m_gameFinished = true;
-    }
+    m_events.dispatch();
   }
 
   void updateCamera()
@@ -333,6 +234,27 @@ struct GameState : Scene, private IGame
       };
 
     m_tilesForDisplay->scan(onCell);
+
+    auto onAttributes =
+      [&] (int x, int y, int attributes)
+      {
+        if(attributes & (1 << TILE_HAZARD))
+        {
+          auto actor = Actor { Vector(x, y), MDL_SPIKES };
+          actor.scale = Size(1, 0.95);
+          actor.ratio = 0;
+          m_view->sendActor(actor);
+        }
+
+        if(attributes & (1 << TILE_CLIMBABLE))
+        {
+          auto actor = Actor { Vector(x, y), MDL_LADDER };
+          actor.scale = UnitSize;
+          m_view->sendActor(actor);
+        }
+      };
+
+    m_attributes->scan(onAttributes);
   }
 
   void removeDeadThings()
@@ -369,20 +291,42 @@ struct GameState : Scene, private IGame
   void loadLevel(int levelIdx)
   {
     ///////////////////////////////////////////////////////////////////////////
-    // destroy current game arena
+    // leave current game arena
     ///////////////////////////////////////////////////////////////////////////
     if(m_player)
     {
       for(auto& entity : m_entities)
         if(m_player == entity.get())
           entity.release();
-    }
 
-    m_physics.reset();
+      m_entities.erase(remove(m_entities.begin(), m_entities.end(), nullptr), m_entities.end());
+    }
 
-    m_entities.clear();
     m_spawned.clear();
 
+    // the saved variables are about to be restored:
+    // the suspended rooms don't match them anymore.
+    if(m_shouldLoadVars)
+      m_roomCache.clear();
+
+    if(m_physics && !m_shouldLoadVars)
+    {
+      m_physics->removeBody(m_player);
+
+      auto room = make_unique<PreparedRoom>();
+      room->levelIdx = m_loadedLevel;
+      room->pool = move(m_roomPool);
+      room->physics = move(m_physics);
+      room->entities = move(m_entities);
+      m_entities.clear();
+      m_roomCache.suspend(move(room));
+    }
+    else
+    {
+      m_physics.reset();
+      m_entities.clear();
+    }
+
     if(m_shouldLoadVars)
     {
       m_vars.clear();
@@ -394,19 +338,37 @@ struct GameState : Scene, private IGame
     }
 
     ///////////////////////////////////////////////////////////////////////////
-    // create new game arena
+    // enter the new game arena
     ///////////////////////////////////////////////////////////////////////////
 
-    m_physics = createPhysics();
-    m_physics->setEdifice(bind(&GameState::isBoxSolid, this, placeholders::_1));
+    auto room = m_roomCache.take(levelIdx);
 
-    if(levelIdx < 0 || levelIdx >= (int)m_quest.rooms.size())
-      throw runtime_error("No such level");
+    if(!room)
+      room = m_streamer.take(levelIdx);
+
+    // all the entities of the previous room are gone, or suspended
+    m_roomPool = move(room->pool);
+    m_physics = move(room->physics);
+    m_loadedLevel = levelIdx;
+
+    if(room->suspended)
+    {
+      for(auto& entity : room->entities)
+      {
+        entity->resume();
+        m_entities.push_back(move(entity));
+      }
+    }
+    else
+    {
+      for(auto& entity : room->entities)
+        spawn(entity.release());
+    }
 
-    auto& level = m_quest.rooms[levelIdx];
-    spawnEntities(level, this, levelIdx);
+    auto& level = m_quest->rooms[levelIdx];
     m_tiles = &level.tiles;
     m_tilesForDisplay = &level.tiles;
+    m_attributes = &level.attributes;
     m_theme = level.theme;
     m_view->playMusic(level.theme);
 
@@ -417,21 +379,39 @@ struct GameState : Scene, private IGame
       m_view->preload({ ResourceType::Model, MDL_BACKGROUND, buffer });
     }
 
+    // get the next rooms ready, while the player is in this one
+    auto const adjacentRooms = getAdjacentRooms(level);
+
+    {
+      vector<int> toPrepare;
+
+      for(auto adjacent : adjacentRooms)
+        if(!m_roomCache.contains(adjacent))
+          toPrepare.push_back(adjacent);
+
+      m_streamer.prefetch(toPrepare);
+    }
+
+    for(auto adjacent : adjacentRooms)
+      m_view->preload({ ResourceType::Music, m_quest->rooms[adjacent].theme, nullptr });
+
     if(!m_player)
     {
+      // the player outlives the rooms
+      EntityPoolScope heapScope(nullptr);
       m_player = makeRockman().release();
       m_player->pos = Vector(level.start.x, level.start.y);
-      postEvent(make_unique<SaveEvent>());
+      m_events.post(SaveEvent());
     }
 
     spawn(m_player);
   }
 
-  void onTouchLevelBoundary(const TouchLevelBoundary* event)
+  void onTouchLevelBoundary(TouchLevelBoundary const& event)
   {
     m_shouldLoadLevel = true;
-    m_transform = event->transform;
-    m_level = event->targetLevel;
+    m_transform = event.transform;
+    m_level = event.targetLevel;
   }
 
   int m_level = 1;
@@ -441,7 +421,7 @@ struct GameState : Scene, private IGame
   bool m_shouldLoadVars = false;
 
   map<int, unique_ptr<IVariable>> m_vars;
-  vector<unique_ptr<Event>> m_eventQueue;
+  EventBus m_events;
 
   ////////////////////////////////////////////////////////////////
   // IGame: game, as seen by the entities
@@ -469,9 +449,9 @@ struct GameState : Scene, private IGame
     return m_vars[name].get();
   }
 
-  void postEvent(unique_ptr<Event> event) override
+  void postEvent(int id, const void* payload, int size) override
   {
-    m_eventQueue.push_back(move(event));
+    m_events.post(id, payload, size);
   }
 
   Vector getPlayerPosition() override
@@ -502,6 +482,11 @@ struct GameState : Scene, private IGame
     m_shouldLoadVars = true;
   }
 
+  int random() override
+  {
+    return pseudoRandom(m_randomSeed);
+  }
+
   void textBox(char const* msg) override
   {
     m_view->textBox(msg);
@@ -512,7 +497,10 @@ struct GameState : Scene, private IGame
     m_view->setAmbientLight(light);
   }
 
-  Quest m_quest;
+  // shared with the other instances
+  shared_ptr<const Quest> const m_quest;
+  uint32_t m_randomSeed;
+
   Player* m_player = nullptr;
   View* const m_view;
   unique_ptr<IPhysics> m_physics;
@@ -520,33 +508,21 @@ struct GameState : Scene, private IGame
 
   const Matrix2<int>* m_tiles;
   const Matrix2<int>* m_tilesForDisplay;
+  const Matrix2<int>* m_attributes;
   bool m_debug;
   bool m_debugFirstTime = true;
   Toggle startButton;
 
+  RoomStreamer m_streamer;
+  RoomCache m_roomCache;
+  int m_loadedLevel = -1;
+
+  // must outlive the entities
+  unique_ptr<EntityPool> m_roomPool;
+
   vector<unique_ptr<Entity>> m_entities;
   vector<unique_ptr<Entity>> m_spawned;
 
-  bool isBoxSolid(IntBox box)
-  {
-    auto const x1 = box.pos.x;
-    auto const y1 = box.pos.y;
-    auto const x2 = box.pos.x + box.size.width;
-    auto const y2 = box.pos.y + box.size.height;
-
-    auto const col1 = x1 / PRECISION;
-    auto const col2 = x2 / PRECISION;
-    auto const row1 = y1 / PRECISION;
-    auto const row2 = y2 / PRECISION;
-
-    for(int row = row1; row <= row2; row++)
-      for(int col = col1; col <= col2; col++)
-        if(m_tiles->isInside(col, row) && m_tiles->get(col, row))
-          return true;
-
-    return false;
-  }
-
   // static stuff
 
   static Actor getDebugActor(Entity* entity)
@@ -566,6 +542,32 @@ Scene* createPlayingStateAtLevel(View* view, int level)
   return gameState.release();
 }
 
+Scene* createPlayingStateForQuest(View* view, shared_ptr<const Quest> quest, int level, uint32_t seed)
+{
+  auto gameState = make_unique<GameState>(view, quest, seed);
+  gameState->m_level = level;
+  return gameState.release();
+}
+
+void setRoomCacheBudget(size_t bytes)
+{
+  g_roomCacheBudget = bytes;
+}
+
+GameStats getGameStats(Scene* scene)
+{
+  GameStats r;
+
+  if(auto gameState = dynamic_cast<GameState*>(scene))
+  {
+    r.roomCacheHits = gameState->m_roomCache.hits;
+    r.roomCacheMisses = gameState->m_roomCache.misses;
+    r.roomCacheEvictions = gameState->m_roomCache.evictions;
+  }
+
+  return r;
+}
+
 Scene* createPlayingState(View* view)
 {
   return createPlayingStateAtLevel(view, 1);
@@ -0,0 +1,20 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Per-tile properties, other than solidity.
+// A room stores them as bit flags (1 << attribute), one cell per tile.
+
+#pragma once
+
+enum TileAttribute
+{
+  TILE_HAZARD, // hurts on contact (spikes)
+  TILE_CLIMBABLE, // ladders
+  TILE_ATTRIBUTE_COUNT,
+};
+
+// hazards only fill the bottom of their tile, up to this height
+static auto const HAZARD_HEIGHT = 0.95;
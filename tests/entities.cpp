@@ -31,7 +31,10 @@ unittest("Entity: explosion")
   assertEquals(0, getActor(explosion).ratio);
 
   for(int i = 0; i < 10000; ++i)
+  {
+    explosion->prepare();
     explosion->tick();
+  }
 
   assert(explosion->dead);
   assertEquals(100, int(getActor(explosion).ratio * 100));
@@ -62,11 +65,12 @@ struct NullGame : IGame
   virtual void stopMusic() {};
   virtual void spawn(Entity*) {}
   virtual IVariable* getVariable(int) { return &nullVariable; }
-  virtual void postEvent(unique_ptr<Event> ) {}
+  virtual void postEvent(int, const void*, int) {}
   virtual Vector2f getPlayerPosition() { return Vector2f(0, 0); }
   virtual void textBox(char const*) {}
   virtual void setAmbientLight(float) {}
   virtual void respawn() {};
+  virtual int random() { return 0; }
 };
 
 struct NullPhysicsProbe : IPhysicsProbe
@@ -85,6 +89,25 @@ struct NullPhysicsProbe : IPhysicsProbe
     return true;
   }
 
+  void syncBody(Body*)
+  {
+  }
+
+  Body* resolve(BodyHandle) const
+  {
+    return nullptr;
+  }
+
+  Sweep sweepBody(Body* body, Vector2f delta)
+  {
+    Sweep r;
+
+    if(!moveBody(body, delta))
+      r.fraction = 0;
+
+    return r;
+  }
+
   bool isSolid(const Body* /*body*/, IntBox rect) const
   {
     return rect.pos.y < 0;
@@ -94,6 +117,23 @@ struct NullPhysicsProbe : IPhysicsProbe
   {
     return nullptr;
   }
+
+  int queryBox(IntBox, int, Span<Body*>, bool, const Body*) const
+  {
+    return 0;
+  }
+
+  RayHit raycast(Vector, Vector, float maxDist, int, const Body*) const
+  {
+    RayHit r;
+    r.distance = maxDist;
+    return r;
+  }
+
+  bool findTile(IntBox, TileAttribute, Vector2i*) const
+  {
+    return false;
+  }
 };
 
 float g_AmbientLight = 0;
@@ -0,0 +1,111 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/tests/tests.h"
+#include "src/entity_pool.h"
+#include "src/entity.h"
+#include "src/entities/explosion.h"
+
+unittest("EntityPool: released blocks are reused")
+{
+  EntityPool pool;
+  EntityPoolScope scope(&pool);
+
+  auto first = makeExplosion();
+  auto const firstAddress = (void*)first.get();
+  first.reset();
+
+  assertEquals(0, pool.liveBlocks());
+
+  auto second = makeExplosion();
+  assertEquals(1, pool.liveBlocks());
+  assert((void*)second.get() == firstAddress);
+}
+
+unittest("EntityPool: handles of dead entities resolve to null")
+{
+  EntityPool pool;
+  EntityPoolScope scope(&pool);
+
+  auto explosion = makeExplosion();
+  auto const handle = pool.handleOf(explosion.get());
+
+  assert(pool.resolve(handle) == explosion.get());
+
+  explosion.reset();
+  assert(pool.resolve(handle) == nullptr);
+
+  // same block, new entity: the old handle still resolves to null
+  auto other = makeExplosion();
+  assert(pool.resolve(handle) == nullptr);
+  assert(pool.resolve(pool.handleOf(other.get())) == other.get());
+
+  other.reset();
+  pool.reset();
+
+  auto afterReset = makeExplosion();
+  assert(pool.resolve(handle) == nullptr);
+  assert(pool.resolve(EntityHandle()) == nullptr);
+}
+
+unittest("EntityPool: no current pool means the heap")
+{
+  EntityPool pool;
+
+  auto fromHeap = makeExplosion();
+  assertEquals(0, pool.liveBlocks());
+  assert(pool.resolve(pool.handleOf(fromHeap.get())) == nullptr);
+
+  {
+    EntityPoolScope scope(&pool);
+    auto fromPool = makeExplosion();
+    assertEquals(1, pool.liveBlocks());
+
+    EntityPoolScope heapScope(nullptr);
+    auto fromHeapAgain = makeExplosion();
+    assertEquals(1, pool.liveBlocks());
+  }
+
+  assertEquals(0, pool.liveBlocks());
+}
+
+unittest("EntityPool: handles don't resolve in another pool")
+{
+  EntityPool first;
+  EntityPool second;
+
+  EntityPoolScope scope(&first);
+  auto explosion = makeExplosion();
+  auto const handle = first.handleOf(explosion.get());
+
+  {
+    EntityPoolScope otherScope(&second);
+    auto other = makeExplosion();
+
+    // same block index, same generation
+    assert(second.resolve(second.handleOf(other.get())) == other.get());
+    assert(second.resolve(handle) == nullptr);
+  }
+
+  assert(first.resolve(handle) == explosion.get());
+}
+
+unittest("EntityPool: entities not allocated by the pool have no handle")
+{
+  struct LocalEntity : Entity
+  {
+    void addActors(vector<Actor> &) const override {}
+  };
+
+  EntityPool pool;
+  EntityPoolScope scope(&pool);
+
+  auto pooled = makeExplosion();
+  LocalEntity local;
+
+  assert(pool.resolve(pool.handleOf(&local)) == nullptr);
+  assert(pool.resolve(pool.handleOf(pooled.get())) == pooled.get());
+}
@@ -0,0 +1,144 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/tests/tests.h"
+#include "src/event_bus.h"
+#include <string>
+
+namespace
+{
+struct Ping
+{
+  static int const ID = 0;
+  int value;
+};
+
+struct Move
+{
+  static int const ID = 3;
+  double x, y;
+  char tag;
+};
+
+struct Ignored
+{
+  static int const ID = 5;
+};
+}
+
+unittest("EventBus: handlers are called in posting order")
+{
+  EventBus bus;
+  std::string log;
+
+  bus.subscribe<Ping>([&] (Ping const& e) { log += "p" + std::to_string(e.value); });
+  bus.subscribe<Move>([&] (Move const& e) { log += "m" + std::to_string(int(e.x + e.y)) + e.tag; });
+
+  bus.post(Ping { 1 });
+  bus.post(Move { 2, 3, 'a' });
+  bus.post(Ignored {});
+  bus.post(Ping { 7 });
+
+  bus.dispatch();
+
+  assertEquals("p1m5ap7", log);
+  assert(bus.empty());
+}
+
+unittest("EventBus: events posted by handlers wait for the next dispatch")
+{
+  EventBus bus;
+  int pings = 0;
+
+  bus.subscribe<Ping>([&] (Ping const& e)
+    {
+      ++pings;
+
+      if(e.value > 0)
+        bus.post(Ping { e.value - 1 });
+    });
+
+  bus.post(Ping { 2 });
+
+  bus.dispatch();
+  assertEquals(1, pings);
+
+  bus.dispatch();
+  assertEquals(2, pings);
+
+  bus.dispatch();
+  assertEquals(3, pings);
+  assert(bus.empty());
+}
+
+unittest("EventBus: records wrap around the ring buffer")
+{
+  EventBus bus(100);
+  int sum = 0;
+  int count = 0;
+
+  bus.subscribe<Move>([&] (Move const& e) { sum += int(e.x); ++count; });
+
+  // 24-byte payloads (32-byte records) don't divide the 104-byte buffer
+  for(int i = 0; i < 50; ++i)
+  {
+    bus.post(Move { double(i), 0, 'z' });
+    bus.post(Move { double(i), 0, 'z' });
+    bus.dispatch();
+  }
+
+  assertEquals(100, count);
+  assertEquals(2 * 49 * 50 / 2, sum);
+}
+
+unittest("EventBus: a full ring buffer grows")
+{
+  EventBus bus(64);
+  std::string log;
+
+  bus.subscribe<Ping>([&] (Ping const& e) { log += std::to_string(e.value); });
+
+  for(int i = 0; i < 9; ++i)
+    bus.post(Ping { i });
+
+  assert(bus.capacity() > 64);
+
+  bus.dispatch();
+  assertEquals("012345678", log);
+  assert(bus.empty());
+}
+
+unittest("EventBus: handlers can grow the ring buffer")
+{
+  EventBus bus(64);
+  std::string log;
+
+  bus.subscribe<Ping>([&] (Ping const& e)
+    {
+      log += std::to_string(e.value);
+
+      // the buffer grows under this handler's event
+      if(e.value == 1)
+      {
+        for(int i = 0; i < 8; ++i)
+          bus.post(Ping { 5 });
+      }
+
+      log += std::to_string(e.value);
+    });
+
+  bus.post(Ping { 1 });
+  bus.post(Ping { 2 });
+  bus.post(Ping { 3 });
+
+  bus.dispatch();
+  assertEquals("112233", log);
+  assert(bus.capacity() > 64);
+
+  bus.dispatch();
+  assertEquals("112233" + std::string(16, '5'), log);
+  assert(bus.empty());
+}
@@ -0,0 +1,141 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/tests/tests.h"
+#include "engine/src/misc/jobs.h"
+#include "engine/src/misc/replay.h" // FrameHash
+#include "src/spawn_program.h"
+#include "src/state_machine.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct HashingView : View
+{
+  void setTitle(char const*) override {}
+  void preload(Resource) override {}
+  void textBox(char const*) override {}
+  void playMusic(MUSIC) override {}
+  void stopMusic() override {}
+  void playSound(SOUND) override {}
+  void setCameraPos(Vector2f) override {}
+  void setAmbientLight(float) override {}
+
+  void sendActor(Actor const& actor) override
+  {
+    hash.add(actor);
+  }
+
+  FrameHash hash;
+};
+
+// one room cell, walled, whose floor is made of hatches and fragile
+// blocks, under a crowd of monsters: more entities than the grain of
+// the parallel 'prepare' phase.
+shared_ptr<const Quest> createCrowdedQuest()
+{
+  Room room;
+  room.size = Size2i(1, 1);
+  room.tiles.resize(Size2i(16, 16));
+  room.tiles.scan([] (int x, int y, int& tile) { tile = y == 0 || x == 0 || x == 15; });
+  room.start = Vector2i(2, 2);
+
+  for(int x = 3; x < 15; ++x)
+    room.spawners.push_back({ Vector(x, 1), x % 3 ? "hatch" : "fragile_block" });
+
+  char const* monsters[] = { "spider", "hopper", "sweeper", "wheel" };
+
+  for(int i = 0; i < 80; ++i)
+    room.spawners.push_back({ Vector(1 + i % 14, 4 + i / 14 * 2), monsters[i % 4] });
+
+  auto quest = make_shared<Quest>();
+  quest->rooms.push_back(move(room));
+  compileSpawnPrograms(*quest);
+  return quest;
+}
+
+// the frame checksum after each tick
+vector<uint32_t> play(shared_ptr<const Quest> quest, uint32_t seed)
+{
+  HashingView view;
+  unique_ptr<Scene> scene(createPlayingStateForQuest(&view, quest, 0, seed));
+
+  vector<uint32_t> r;
+
+  for(int i = 0; i < 600; ++i)
+  {
+    Control c {};
+    c.right = (i / 100) % 2 == 0;
+    c.left = !c.right;
+    c.jump = i % 40 < 10;
+    c.fire = i % 15 == 0;
+
+    auto next = scene->tick(c);
+
+    if(next != scene.get())
+    {
+      scene.release();
+      scene.reset(next);
+    }
+
+    view.hash = FrameHash();
+    scene->draw();
+    r.push_back(view.hash.value);
+  }
+
+  return r;
+}
+}
+
+unittest("Game: the same game, whatever the number of job workers")
+{
+  auto const quest = createCrowdedQuest();
+
+  auto const serial = play(quest, 1234);
+
+  startJobSystem(3);
+  auto const parallel = play(quest, 1234);
+  startJobSystem(0);
+
+  // the game does move
+  assert(serial.front() != serial.back());
+
+  assertEquals(serial.size(), parallel.size());
+
+  for(int i = 0; i < (int)serial.size(); ++i)
+    assertEquals(serial[i], parallel[i]);
+}
+
+unittest("Game: batch instances share the job system")
+{
+  auto const quest = createCrowdedQuest();
+  auto const numInstances = 3;
+
+  vector<vector<uint32_t>> expected;
+
+  for(int i = 0; i < numInstances; ++i)
+    expected.push_back(play(quest, 1234 + i));
+
+  // like 'headless --batch': each thread runs its own game, and their
+  // 'prepare' phases are all spread on the same workers
+  startJobSystem(2);
+
+  vector<vector<uint32_t>> actual(numInstances);
+  vector<thread> threads;
+
+  for(int i = 0; i < numInstances; ++i)
+    threads.push_back(thread([&, i] () { actual[i] = play(quest, 1234 + i); }));
+
+  for(auto& t : threads)
+    t.join();
+
+  startJobSystem(0);
+
+  for(int i = 0; i < numInstances; ++i)
+    assert(expected[i] == actual[i]);
+}
@@ -76,3 +76,118 @@ unittest("LevelGraph: getRoomAt: 1x2 room at (10;4)")
   assertEquals(-1, getRoomAt(rooms, Vector2i(9, 4)));
 }
 
+
+#include "preprocess_quest.h"
+#include "spawn_program.h"
+
+// Where crossing each edge cell of 'room' leads: one cell at a time,
+// like the preprocessing used to do.
+struct Crossing
+{
+  Vector2i cell; // outside of the room, relative to it
+  int target;
+  Vector2i transform;
+};
+
+static
+vector<Crossing> getExpectedCrossings(vector<Room> const& rooms, int roomIdx)
+{
+  auto& room = rooms[roomIdx];
+  vector<Crossing> r;
+
+  auto add = [&] (Vector2i cell, Vector2i margin)
+    {
+      auto const target = getRoomAt(rooms, room.pos + cell);
+      auto transform = Vector2i(0, 0);
+
+      if(target >= 0)
+        transform = (room.pos - rooms[target].pos) * 16 + margin;
+
+      r.push_back({ cell, target, transform });
+    };
+
+  for(int row = 0; row < room.size.height; ++row)
+  {
+    add(Vector2i(-1, row), Vector2i(-1, 0));
+    add(Vector2i(room.size.width, row), Vector2i(1, 0));
+  }
+
+  for(int col = 0; col < room.size.width; ++col)
+  {
+    add(Vector2i(col, -1), Vector2i(0, -2));
+    add(Vector2i(col, room.size.height), Vector2i(0, 2));
+  }
+
+  return r;
+}
+
+static
+Room createRoom(Vector2i pos, Size2i size)
+{
+  Room room;
+  room.pos = pos;
+  room.size = size;
+  room.tiles.resize(Size2i(size.width * 16, size.height * 16));
+  return room;
+}
+
+unittest("LevelGraph: merged boundaries lead to the same places")
+{
+  Quest quest;
+  quest.rooms.push_back(createRoom(Vector2i(0, 0), Size2i(2, 3)));
+  quest.rooms.push_back(createRoom(Vector2i(2, 0), Size2i(1, 1)));
+  quest.rooms.push_back(createRoom(Vector2i(2, 1), Size2i(2, 1)));
+  quest.rooms.push_back(createRoom(Vector2i(0, 3), Size2i(4, 1)));
+
+  preprocessQuest(quest, 0);
+
+  for(int i = 0; i < (int)quest.rooms.size(); ++i)
+  {
+    auto& room = quest.rooms[i];
+    auto program = compileSpawners(room.spawners);
+
+    for(auto& crossing : getExpectedCrossings(quest.rooms, i))
+    {
+      auto const center = Vector(crossing.cell.x * 16 + 8, crossing.cell.y * 16 + 8);
+      int found = 0;
+
+      for(auto& op : program.ops)
+      {
+        auto const width = getSpawnArg(program, op, "width")->value;
+        auto const height = getSpawnArg(program, op, "height")->value;
+
+        if(center.x < op.pos.x || center.x >= op.pos.x + width)
+          continue;
+
+        if(center.y < op.pos.y || center.y >= op.pos.y + height)
+          continue;
+
+        ++found;
+
+        if(crossing.target < 0)
+        {
+          assert(getSpawnArg(program, op, "0") == nullptr);
+          continue;
+        }
+
+        assertEquals(crossing.target, getSpawnArg(program, op, "0")->value);
+        assertEquals(crossing.transform.x, getSpawnArg(program, op, "1")->value);
+        assertEquals(crossing.transform.y, getSpawnArg(program, op, "2")->value);
+      }
+
+      assertEquals(1, found);
+    }
+  }
+
+  // room 0, right edge: 3 cells, leading to room 1, room 2, and nowhere.
+  // Top edge: 2 cells, leading to room 3.
+  assertEquals(1 + 3 + 1 + 1, (int)quest.rooms[0].spawners.size());
+
+  // from the middle of the right edge of room 0, into room 2
+  auto const program = compileSpawners(quest.rooms[0].spawners);
+  auto const& toRoom2 = program.ops[2]; // left edge first, then right edge
+  assertEquals(2, getSpawnArg(program, toRoom2, "0")->value);
+  assertEquals(-31, getSpawnArg(program, toRoom2, "1")->value);
+  assertEquals(-16, getSpawnArg(program, toRoom2, "2")->value);
+}
+
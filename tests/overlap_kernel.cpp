@@ -0,0 +1,48 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/tests/tests.h"
+#include "src/overlap_kernel.h"
+#include "engine/src/misc/random.h"
+#include <vector>
+
+using namespace std;
+
+unittest("Overlap kernel: same result as 'overlaps'")
+{
+  uint32_t seed = 42;
+
+  for(int count = 0; count <= 64; ++count)
+  {
+    vector<int> x1(count), y1(count), x2(count), y2(count);
+    vector<IntBox> boxes(count);
+
+    // small coordinates, so touching and empty boxes are frequent
+    for(int i = 0; i < count; ++i)
+    {
+      boxes[i] = IntBox(pseudoRandom(seed) % 16, pseudoRandom(seed) % 16, pseudoRandom(seed) % 6, pseudoRandom(seed) % 6);
+      x1[i] = boxes[i].pos.x;
+      y1[i] = boxes[i].pos.y;
+      x2[i] = boxes[i].pos.x + boxes[i].size.width;
+      y2[i] = boxes[i].pos.y + boxes[i].size.height;
+    }
+
+    for(int k = 0; k < 20; ++k)
+    {
+      auto const query = IntBox(pseudoRandom(seed) % 16, pseudoRandom(seed) % 16, pseudoRandom(seed) % 6, pseudoRandom(seed) % 6);
+
+      uint64_t expected = 0;
+
+      for(int i = 0; i < count; ++i)
+        if(overlaps(boxes[i], query))
+          expected |= uint64_t(1) << i;
+
+      assertEquals(expected, overlapMaskScalar(query, x1.data(), y1.data(), x2.data(), y2.data(), count));
+      assertEquals(expected, overlapMask(query, x1.data(), y1.data(), x2.data(), y2.data(), count));
+    }
+  }
+}
+
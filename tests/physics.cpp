@@ -8,8 +8,12 @@
 
 #include "engine/tests/tests.h"
 #include "src/body.h"
+#include "src/collision_groups.h"
 #include "src/physics.h"
+#include "engine/src/misc/jobs.h"
+#include "engine/src/misc/random.h"
 #include <cmath>
+#include <limits>
 #include <memory>
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,17 +49,23 @@ void assertNearlyEqualsFunc(Vector2f expected, Vector2f actual, const char* file
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// everything at x < 0 or y < 0 is solid
 static
-bool isSolid(IntBox rect)
+SolidityMap createEdifice()
 {
-  return rect.pos.y < 0 || rect.pos.x < 0;
+  auto const margin = 64;
+  Matrix2<int> tiles(Size2i(512, 512));
+
+  tiles.scan([&] (int x, int y, int& tile) { tile = x < margin || y < margin; });
+
+  return SolidityMap(tiles, Vector2i(-margin, -margin));
 }
 
 struct Fixture
 {
   Fixture() : physics(createPhysics())
   {
-    physics->setEdifice(&isSolid);
+    physics->setEdifice(createEdifice());
     physics->addBody(&mover);
   }
 
@@ -84,6 +94,26 @@ unittest("Physics: left move, blocked by vertical wall at x=0")
   assertNearlyEquals(Vector2f(10, 10), fix.mover.pos);
 }
 
+unittest("Physics: static geometry at negative coordinates")
+{
+  Fixture fix;
+
+  // between x=-1 and x=0: inside the tile -1
+  assert(fix.physics->isSolid(&fix.mover, roundBox(Box(-0.5, 10, 0.25, 0.25))));
+  assert(fix.physics->isSolid(&fix.mover, roundBox(Box(10, -0.5, 0.25, 0.25))));
+  assert(!fix.physics->isSolid(&fix.mover, roundBox(Box(0.25, 10, 0.25, 0.25))));
+
+  auto const hit = fix.physics->raycast(Vector(0.5, 10.5), Vector(-1, 0), 10, CG_ALL);
+  assert(hit.hit);
+  assertNearlyEquals(Vector2f(0.5, 0), Vector2f(hit.distance, 0));
+
+  fix.mover.pos = Vector2f(0.5, 10);
+  fix.mover.size = Size2f(0.25, 0.25);
+  auto const sweep = fix.physics->sweepBody(&fix.mover, Vector2f(-1, 0));
+  assertNearlyEquals(Vector2f(0.5, 0), Vector2f(sweep.fraction, 0));
+  assertNearlyEquals(Vector2f(0, 10), fix.mover.pos);
+}
+
 unittest("Physics: left move, blocked by a bigger body")
 {
   Fixture fix;
@@ -102,3 +132,909 @@ unittest("Physics: left move, blocked by a bigger body")
   assertNearlyEquals(Vector2f(100, 10), fix.mover.pos);
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+
+#include "base/util.h" // allPairs, unstableRemove
+
+namespace
+{
+struct CollisionLog
+{
+  vector<pair<int, int>> entries;
+  Body* base = nullptr;
+
+  void record(Body* me, Body* other)
+  {
+    entries.push_back({ int(me - base), int(other - base) });
+  }
+};
+
+// reference implementation: test every pair, in registration order
+CollisionLog bruteForceOverlaps(vector<Body*> const& order, Body* base)
+{
+  CollisionLog log;
+  log.base = base;
+
+  for(auto p : allPairs((int)order.size()))
+  {
+    auto& me = *order[p.first];
+    auto& other = *order[p.second];
+
+    if(!overlaps(me.getBox(), other.getBox()))
+      continue;
+
+    if(other.collidesWith & me.collisionGroup)
+      log.record(&other, &me);
+
+    if(me.collidesWith & other.collisionGroup)
+      log.record(&me, &other);
+  }
+
+  return log;
+}
+}
+
+unittest("Physics: broadphase reports the same pairs as a brute-force scan")
+{
+  auto physics = createPhysics();
+
+  uint32_t seed = 1234;
+  vector<Body> bodies(300);
+  vector<Body*> order;
+  CollisionLog log;
+  log.base = bodies.data();
+
+  for(auto& body : bodies)
+  {
+    body.pos = Vector2f(pseudoRandom(seed) % 600, pseudoRandom(seed) % 600) * 0.1;
+    body.size = Size2f(1 + pseudoRandom(seed) % 60, 1 + pseudoRandom(seed) % 60) * 0.1;
+    body.collisionGroup = 1 << (pseudoRandom(seed) % 3);
+    body.collidesWith = pseudoRandom(seed) % 8;
+    body.onCollision = [&log, &body] (Body* other) { log.record(&body, other); };
+    physics->addBody(&body);
+    order.push_back(&body);
+  }
+
+  auto checkSamePairs = [&] ()
+    {
+      log.entries.clear();
+      physics->checkForOverlaps();
+      auto expected = bruteForceOverlaps(order, bodies.data());
+      assert(!expected.entries.empty());
+      assertEquals(expected.entries, log.entries);
+    };
+
+  checkSamePairs();
+
+  // move some bodies through the physics, teleport others
+  for(int i = 0; i < (int)bodies.size(); i += 3)
+    physics->moveBody(&bodies[i], Vector2f(pseudoRandom(seed) % 100 - 50, pseudoRandom(seed) % 100 - 50) * 0.1);
+
+  for(int i = 1; i < (int)bodies.size(); i += 7)
+    bodies[i].pos += Vector2f(5, -3);
+
+  checkSamePairs();
+
+  // remove some bodies
+  for(int i = 0; i < (int)bodies.size(); i += 5)
+  {
+    physics->removeBody(&bodies[i]);
+    unstableRemove(order, [&] (Body* b) { return b == &bodies[i]; });
+  }
+
+  checkSamePairs();
+}
+
+unittest("Physics: resting bodies aren't tested against each other")
+{
+  for(auto deferred : { false, true })
+  {
+    auto physics = createPhysics();
+    physics->setDeferredContacts(deferred);
+
+    uint32_t seed = 777;
+    vector<Body> bodies(300);
+    vector<Body*> order;
+    CollisionLog log;
+    log.base = bodies.data();
+
+    for(auto& body : bodies)
+    {
+      body.pos = Vector2f(pseudoRandom(seed) % 600, pseudoRandom(seed) % 600) * 0.1;
+      body.size = Size2f(1 + pseudoRandom(seed) % 60, 1 + pseudoRandom(seed) % 60) * 0.1;
+      body.onCollision = [&log, &body] (Body* other) { log.record(&body, other); };
+      physics->addBody(&body);
+      order.push_back(&body);
+    }
+
+    auto checkSamePairs = [&] ()
+      {
+        log.entries.clear();
+        physics->checkForOverlaps();
+        assertEquals(bruteForceOverlaps(order, bodies.data()).entries, log.entries);
+      };
+
+    checkSamePairs();
+
+    auto const first = physics->getStats();
+    assertEquals(300, first.awakeBodies);
+    assertEquals(0, first.skippedPairs);
+
+    for(int pass = 0; pass < 5; ++pass)
+    {
+      // a few bodies move through the physics, one gets teleported
+      for(int i = pass; i < (int)bodies.size(); i += 10)
+        physics->moveBody(&bodies[i], Vector2f(pseudoRandom(seed) % 20 - 10, pseudoRandom(seed) % 20 - 10) * 0.1);
+
+      bodies[pass * 7].pos += Vector2f(1, 0);
+
+      checkSamePairs();
+
+      auto const stats = physics->getStats();
+      assert(stats.awakeBodies <= 31);
+      assertEquals(300, stats.staticBodies + stats.sleepingBodies + stats.awakeBodies);
+      assert(stats.skippedPairs > 0);
+      assert(stats.testedPairs < first.testedPairs / 2);
+    }
+
+    // removing a body shuffles the slots: only the moved body gets woken up
+    for(int k = 10; k < 100; k += 30)
+    {
+      physics->removeBody(&bodies[k]);
+      unstableRemove(order, [&] (Body* b) { return b == &bodies[k]; });
+      checkSamePairs();
+
+      auto const stats = physics->getStats();
+      assertEquals(1, stats.awakeBodies);
+      assert(stats.skippedPairs > 0);
+
+      checkSamePairs();
+    }
+  }
+}
+
+unittest("Physics: deferred contacts are dispatched like immediate ones")
+{
+  uint32_t seed = 4321;
+  vector<Body> bodies(2000);
+  CollisionLog log;
+  log.base = bodies.data();
+
+  for(auto& body : bodies)
+  {
+    body.pos = Vector2f(pseudoRandom(seed) % 1500, pseudoRandom(seed) % 1500) * 0.1;
+    body.size = Size2f(1 + pseudoRandom(seed) % 40, 1 + pseudoRandom(seed) % 40) * 0.1;
+    body.collisionGroup = 1 << (pseudoRandom(seed) % 3);
+    body.collidesWith = pseudoRandom(seed) % 8;
+    body.onCollision = [&log, &body] (Body* other) { log.record(&body, other); };
+  }
+
+  vector<Vector> initialPositions;
+
+  for(auto& body : bodies)
+    initialPositions.push_back(body.pos);
+
+  auto run = [&] (bool deferred, JobSystem* jobs)
+    {
+      auto physics = createPhysics();
+      physics->setDeferredContacts(deferred, jobs);
+
+      for(int i = 0; i < (int)bodies.size(); ++i)
+      {
+        bodies[i].pos = initialPositions[i];
+        physics->addBody(&bodies[i]);
+      }
+
+      log.entries.clear();
+      physics->checkForOverlaps();
+
+      for(int i = 0; i < (int)bodies.size(); i += 3)
+        physics->moveBody(&bodies[i], Vector2f(2, 1));
+
+      physics->checkForOverlaps();
+
+      for(auto& body : bodies)
+        physics->removeBody(&body);
+
+      return log.entries;
+    };
+
+  JobSystem noWorkers(0);
+  JobSystem jobs(3);
+
+  auto const reference = run(false, nullptr);
+  assert(!reference.empty());
+
+  assertEquals(reference, run(true, &noWorkers));
+  assertEquals(reference, run(true, &jobs));
+}
+
+unittest("Physics: getBodiesInBox returns the first match in registration order")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(50, 50);
+
+  Body bodies[4];
+
+  bodies[0].collisionGroup = 2;
+  bodies[1].solid = true;
+  bodies[2].solid = true;
+
+  for(auto& body : bodies)
+  {
+    body.pos = Vector2f(10, 10);
+    body.size = Size2f(2, 2);
+    fix.physics->addBody(&body);
+  }
+
+  auto const box = roundBox(Rect2f(10.5, 10.5, 1, 1));
+
+  assert(&bodies[1] == fix.physics->getBodiesInBox(box, 1));
+  assert(&bodies[0] == fix.physics->getBodiesInBox(box, 2));
+  assert(&bodies[2] == fix.physics->getBodiesInBox(box, 1, true, &bodies[1]));
+  assert(nullptr == fix.physics->getBodiesInBox(box, 4));
+  assert(nullptr == fix.physics->getBodiesInBox(roundBox(Rect2f(12, 10, 1, 1)), -1));
+
+  // the removed body's slot gets reused by the last one
+  fix.physics->removeBody(&bodies[1]);
+  assert(&bodies[2] == fix.physics->getBodiesInBox(box, 1, true));
+  assert(&bodies[3] == fix.physics->getBodiesInBox(box, 1));
+}
+
+unittest("Physics: bodies moved while unregistered are found where they are")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(10, 10);
+
+  Body body;
+  body.pos = Vector2f(20, 20);
+  body.size = Size2f(2, 2);
+  fix.physics->addBody(&body);
+  fix.physics->removeBody(&body);
+
+  // like the player, between two rooms
+  body.pos = Vector2f(40, 40);
+  fix.physics->addBody(&body);
+
+  assert(&body == fix.physics->getBodiesInBox(roundBox(Rect2f(40.5, 40.5, 1, 1)), -1));
+  assert(nullptr == fix.physics->getBodiesInBox(roundBox(Rect2f(20.5, 20.5, 1, 1)), -1));
+}
+
+unittest("Physics: queryBox")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(50, 50);
+
+  Body bodies[5];
+
+  for(int i = 0; i < 5; ++i)
+  {
+    bodies[i].pos = Vector2f(i * 3, 0);
+    bodies[i].size = Size2f(2, 2);
+    fix.physics->addBody(&bodies[i]);
+  }
+
+  Body* result[8];
+
+  // bodies 1, 2, 3
+  auto const box = roundBox(Rect2f(4, 1, 6, 1));
+  assertEquals(3, fix.physics->queryBox(box, -1, result));
+  assert(result[0] == &bodies[1]);
+  assert(result[1] == &bodies[2]);
+  assert(result[2] == &bodies[3]);
+
+  assertEquals(2, fix.physics->queryBox(box, -1, result, false, &bodies[2]));
+  assert(result[0] == &bodies[1]);
+  assert(result[1] == &bodies[3]);
+
+  // truncated output
+  assertEquals(2, fix.physics->queryBox(box, -1, { result, 2 }));
+  assert(result[0] == &bodies[1]);
+  assert(result[1] == &bodies[2]);
+
+  assertEquals(0, fix.physics->queryBox(box, -1, result, true));
+}
+
+unittest("Physics: queries match a brute-force scan, in small and big worlds")
+{
+  uint32_t seed = 77;
+
+  // small worlds are scanned linearly, big ones go through the buckets
+  for(auto count : { 10, 100, 1000 })
+  {
+    auto physics = createPhysics();
+    vector<Body> bodies(count);
+
+    for(auto& body : bodies)
+    {
+      body.pos = Vector2f(pseudoRandom(seed) % 600, pseudoRandom(seed) % 600) * 0.1;
+      body.size = Size2f(1 + pseudoRandom(seed) % 60, 1 + pseudoRandom(seed) % 60) * 0.1;
+      body.collisionGroup = 1 << (pseudoRandom(seed) % 3);
+      body.solid = pseudoRandom(seed) % 2;
+      physics->addBody(&body);
+    }
+
+    for(int k = 0; k < 100; ++k)
+    {
+      auto const pos = Vector2f(pseudoRandom(seed) % 600, pseudoRandom(seed) % 600) * 0.1;
+      auto const size = Size2f(1 + pseudoRandom(seed) % 40, 1 + pseudoRandom(seed) % 40) * 0.1;
+      auto const box = roundBox(Rect2f(pos.x, pos.y, size.width, size.height));
+      auto const group = 1 + pseudoRandom(seed) % 7;
+      auto const onlySolid = pseudoRandom(seed) % 2 == 0;
+      auto const except = &bodies[pseudoRandom(seed) % count];
+
+      vector<Body*> expected;
+
+      for(auto& body : bodies)
+      {
+        if(&body != except && (body.collisionGroup & group) && (body.solid || !onlySolid) && overlaps(body.getBox(), box))
+          expected.push_back(&body);
+      }
+
+      Body* result[1000];
+      auto const n = physics->queryBox(box, group, { result, count }, onlySolid, except);
+      assertEquals(expected, vector<Body*>(result, result + n));
+
+      auto const first = expected.empty() ? nullptr : expected[0];
+      assert(first == physics->getBodiesInBox(box, group, onlySolid, except));
+    }
+  }
+}
+
+unittest("Physics: collision group changes are noticed on the next sync")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(50, 50);
+
+  Body body;
+  body.pos = Vector2f(10, 10);
+  body.collisionGroup = CG_WALLS;
+  fix.physics->addBody(&body);
+
+  auto const box = roundBox(Rect2f(10, 10, 1, 1));
+  assert(&body == fix.physics->getBodiesInBox(box, CG_WALLS));
+  assert(nullptr == fix.physics->getBodiesInBox(box, CG_BONUS));
+
+  // not seen until synced
+  body.collisionGroup = 0;
+  assert(&body == fix.physics->getBodiesInBox(box, CG_WALLS));
+
+  fix.physics->syncBody(&body);
+  assert(nullptr == fix.physics->getBodiesInBox(box, CG_WALLS));
+
+  body.collisionGroup = CG_BONUS;
+  fix.physics->checkForOverlaps();
+  assert(&body == fix.physics->getBodiesInBox(box, CG_BONUS));
+  assert(nullptr == fix.physics->getBodiesInBox(box, CG_WALLS));
+
+  // from now on, the body is treated as volatile
+  body.collisionGroup = CG_DOORS;
+  fix.physics->syncBody(&body);
+  assert(&body == fix.physics->getBodiesInBox(box, CG_DOORS));
+}
+
+unittest("Physics: solidity changes are noticed on the next sync")
+{
+  Fixture fix;
+
+  Body body;
+  body.pos = Vector2f(10, 10);
+  body.solid = true;
+  fix.physics->addBody(&body);
+
+  auto const box = roundBox(Rect2f(10, 10, 1, 1));
+  assert(&body == fix.physics->getBodiesInBox(box, -1, true));
+
+  body.solid = false;
+  assert(&body == fix.physics->getBodiesInBox(box, -1, true));
+
+  fix.physics->syncBody(&body);
+  assert(nullptr == fix.physics->getBodiesInBox(box, -1, true));
+  assert(&body == fix.physics->getBodiesInBox(box, -1, false));
+
+  // direct writes are caught up at the start of each frame
+  body.solid = true;
+  body.pos = Vector2f(20, 20);
+  fix.physics->checkForOverlaps();
+  assert(nullptr == fix.physics->getBodiesInBox(box, -1, true));
+  assert(&body == fix.physics->getBodiesInBox(roundBox(Rect2f(20, 20, 1, 1)), -1, true));
+}
+
+unittest("Physics: sweep, free move")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(10, 10);
+
+  auto sweep = fix.physics->sweepBody(&fix.mover, Vector2f(10, 5));
+
+  assertNearlyEquals(Vector2f(20, 15), fix.mover.pos);
+  assertEquals(1.0f, sweep.fraction);
+  assertNearlyEquals(Vector2f(0, 0), sweep.normal);
+}
+
+unittest("Physics: sweep, no tunnelling through a thin body")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(10, 10);
+  fix.mover.size = Size2f(0.5, 0.5);
+
+  Body wall;
+  wall.pos = Vector2f(15, 0);
+  wall.size = Size2f(0.1, 100);
+  wall.solid = true;
+  fix.physics->addBody(&wall);
+
+  int hits = 0;
+  wall.onCollision = [&] (Body* other) { assert(other == &fix.mover); ++hits; };
+
+  // plain moveBody only tests the destination
+  {
+    Body ghost;
+    ghost.pos = Vector2f(10, 20);
+    ghost.size = Size2f(0.5, 0.5);
+    fix.physics->addBody(&ghost);
+    assert(fix.physics->moveBody(&ghost, Vector2f(20, 0)));
+    fix.physics->removeBody(&ghost);
+  }
+
+  auto sweep = fix.physics->sweepBody(&fix.mover, Vector2f(20, 0));
+
+  assertNearlyEquals(Vector2f(14.5, 10), fix.mover.pos);
+  assert(sweep.fraction > 0.2 && sweep.fraction < 0.25);
+  assertNearlyEquals(Vector2f(-1, 0), sweep.normal);
+  assert(sweep.blocker == &wall);
+  assertEquals(1, hits);
+
+  // flush against the wall: can't move any further
+  sweep = fix.physics->sweepBody(&fix.mover, Vector2f(1, 0));
+  assertEquals(0.0f, sweep.fraction);
+  assertNearlyEquals(Vector2f(14.5, 10), fix.mover.pos);
+}
+
+unittest("Physics: sweep, lands flush on the static geometry at high speed")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(10, 10);
+
+  auto sweep = fix.physics->sweepBody(&fix.mover, Vector2f(0, -1000));
+
+  assertNearlyEquals(Vector2f(10, 0), fix.mover.pos);
+  assertNearlyEquals(Vector2f(0, 1), sweep.normal);
+  assert(sweep.blocker == nullptr);
+  assert(sweep.fraction > 0.0099 && sweep.fraction < 0.0101);
+}
+
+unittest("Physics: sweep, diagonal move slides into a corner")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(2, 10);
+
+  // hits the left wall first
+  auto sweep = fix.physics->sweepBody(&fix.mover, Vector2f(-4, -2));
+
+  assertNearlyEquals(Vector2f(0, 9), fix.mover.pos);
+  assertNearlyEquals(Vector2f(1, 0), sweep.normal);
+}
+
+unittest("Physics: sweep, stuck bodies can move out")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(10, 10);
+
+  Body blocker;
+  blocker.pos = Vector2f(10, 10);
+  blocker.size = Size2f(1, 1);
+  blocker.solid = true;
+  fix.physics->addBody(&blocker);
+
+  auto sweep = fix.physics->sweepBody(&fix.mover, Vector2f(0, 3));
+
+  assertEquals(1.0f, sweep.fraction);
+  assertNearlyEquals(Vector2f(10, 13), fix.mover.pos);
+}
+
+unittest("Physics: pushers carry the bodies resting on them")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(10.5, 11);
+
+  Body platform;
+  platform.pos = Vector2f(10, 10);
+  platform.size = Size2f(2, 1);
+  platform.solid = true;
+  platform.pusher = true;
+  fix.physics->addBody(&platform);
+
+  Body bystander;
+  bystander.pos = Vector2f(20, 11);
+  fix.physics->addBody(&bystander);
+
+  // land on the platform
+  fix.physics->moveBody(&fix.mover, Vector2f(0, 0));
+  assert(fix.physics->resolve(fix.mover.floor) == &platform);
+
+  fix.physics->moveBody(&platform, Vector2f(0.5, 0));
+  fix.physics->moveBody(&platform, Vector2f(0, 2));
+
+  assertNearlyEquals(Vector2f(11, 13), fix.mover.pos);
+  assertNearlyEquals(Vector2f(20, 11), bystander.pos);
+
+  // jump off
+  fix.physics->moveBody(&fix.mover, Vector2f(0, 3));
+  assert(fix.physics->resolve(fix.mover.floor) == nullptr);
+
+  fix.physics->moveBody(&platform, Vector2f(0, 1));
+  assertNearlyEquals(Vector2f(11, 16), fix.mover.pos);
+}
+
+unittest("Physics: pushers push the bodies of every group")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(50, 50);
+
+  Body platform;
+  platform.pos = Vector2f(10, 10);
+  platform.size = Size2f(2, 2);
+  platform.solid = true;
+  platform.pusher = true;
+  fix.physics->addBody(&platform);
+
+  // e.g a room boundary detector
+  Body ghost;
+  ghost.pos = Vector2f(11.5, 12.5);
+  ghost.collisionGroup = 0;
+  ghost.collidesWith = 0;
+  fix.physics->addBody(&ghost);
+
+  fix.physics->moveBody(&platform, Vector2f(0, 1));
+
+  assertNearlyEquals(Vector2f(11.5, 13.5), ghost.pos);
+}
+
+unittest("Physics: the floor of a body is a handle")
+{
+  Fixture fix;
+  fix.mover.pos = Vector2f(10, 11);
+
+  Body platform;
+  platform.pos = Vector2f(10, 10);
+  platform.size = Size2f(2, 1);
+  platform.solid = true;
+  platform.pusher = true;
+  fix.physics->addBody(&platform);
+
+  fix.physics->moveBody(&fix.mover, Vector2f(0, 0));
+  assert(fix.physics->resolve(fix.mover.floor) == &platform);
+
+  fix.physics->removeBody(&platform);
+  assert(fix.physics->resolve(fix.mover.floor) == nullptr);
+
+  // the new body takes the free handle index, not the old handles
+  Body other;
+  other.pos = Vector2f(30, 30);
+  fix.physics->addBody(&other);
+
+  assert(fix.physics->resolve(fix.mover.floor) == nullptr);
+  assert(fix.physics->resolve(BodyHandle()) == nullptr);
+
+  // the pushed riders are found through the handles too
+  fix.physics->addBody(&platform);
+  fix.physics->moveBody(&fix.mover, Vector2f(0, 0));
+  assert(fix.physics->resolve(fix.mover.floor) == &platform);
+
+  fix.physics->removeBody(&other);
+  fix.physics->moveBody(&platform, Vector2f(1, 0));
+  assertNearlyEquals(Vector2f(11, 11), fix.mover.pos);
+}
+
+namespace
+{
+// FNV-1a
+struct Hash
+{
+  uint32_t value = 2166136261u;
+
+  void add(int v)
+  {
+    for(int i = 0; i < 4; ++i)
+    {
+      value ^= (v >> (i * 8)) & 0xFF;
+      value *= 16777619u;
+    }
+  }
+};
+
+// Runs the same scripted scenario, in fixed-point mode, and hashes
+// the resulting state. Every build (native, asm.js) must agree.
+uint32_t runFixedPointScenario()
+{
+  auto physics = createPhysics();
+  physics->setFixedPoint(true);
+  physics->setEdifice(createEdifice());
+
+  uint32_t seed = 2019;
+  int collisions = 0;
+  vector<Body> bodies(60);
+
+  for(auto& body : bodies)
+  {
+    body.pos = Vector2f(pseudoRandom(seed) % 400, pseudoRandom(seed) % 400) * 0.1;
+    body.size = Size2f(3 + pseudoRandom(seed) % 20, 3 + pseudoRandom(seed) % 20) * 0.1;
+    body.solid = pseudoRandom(seed) % 3 == 0;
+    body.onCollision = [&] (Body*) { ++collisions; };
+    physics->addBody(&body);
+  }
+
+  for(int tick = 0; tick < 300; ++tick)
+  {
+    for(int i = 0; i < (int)bodies.size(); ++i)
+    {
+      auto const delta = Vector2f(pseudoRandom(seed) % 200 - 100, pseudoRandom(seed) % 200 - 110) * 0.0013;
+
+      if(i % 2)
+        physics->moveBody(&bodies[i], delta);
+      else
+        physics->sweepBody(&bodies[i], delta * 7);
+    }
+
+    physics->checkForOverlaps();
+  }
+
+  Hash hash;
+
+  for(auto& body : bodies)
+  {
+    // positions are an exact view of the integer ones
+    assertEquals(body.getBox().pos.x, int(body.pos.x * PRECISION));
+    assertEquals(body.getBox().pos.y, int(body.pos.y * PRECISION));
+
+    hash.add(body.getBox().pos.x);
+    hash.add(body.getBox().pos.y);
+  }
+
+  hash.add(collisions);
+
+  return hash.value;
+}
+}
+
+unittest("Physics: fixed-point mode is deterministic")
+{
+  // Computed by a native build. A different value means this build
+  // simulates differently, and can't replay other builds' recordings.
+  assertEquals(4265170045u, runFixedPointScenario());
+}
+
+unittest("Physics: fixed-point mode: slow bodies still move")
+{
+  Fixture fix;
+  fix.physics->setFixedPoint(true);
+
+  Body sweeper;
+  fix.physics->addBody(&sweeper);
+
+  fix.mover.pos = Vector2f(10, 10);
+  sweeper.pos = Vector2f(20, 10);
+
+  // a quarter of a PRECISION unit per tick: rounds to zero on its own
+  auto const delta = Vector2f(0.25, -0.25) * (1.0f / PRECISION);
+
+  for(int tick = 0; tick < 400; ++tick)
+  {
+    fix.physics->moveBody(&fix.mover, delta);
+    fix.physics->sweepBody(&sweeper, delta);
+  }
+
+  assertEquals(10 * PRECISION + 100, fix.mover.getBox().pos.x);
+  assertEquals(10 * PRECISION - 100, fix.mover.getBox().pos.y);
+  assertEquals(20 * PRECISION + 100, sweeper.getBox().pos.x);
+  assertEquals(10 * PRECISION - 100, sweeper.getBox().pos.y);
+}
+
+unittest("Physics: raycast hits the static geometry")
+{
+  auto physics = createPhysics();
+  physics->setEdifice(createEdifice());
+
+  {
+    auto const hit = physics->raycast(Vector(10, 5), Vector(-1, 0), 100, CG_ALL);
+    assert(hit.hit);
+    assert(hit.body == nullptr);
+    assertNearlyEquals(Vector(10, 0), Vector(hit.distance, 0));
+    assertNearlyEquals(Vector(1, 0), hit.normal);
+  }
+
+  {
+    auto const hit = physics->raycast(Vector(10, 5), Vector(-3, -3), 100, CG_ALL);
+    assert(hit.hit);
+    assertNearlyEquals(Vector(5 * sqrt(2), 0), Vector(hit.distance, 0));
+    assertNearlyEquals(Vector(0, 1), hit.normal);
+  }
+
+  {
+    auto const hit = physics->raycast(Vector(10, 5), Vector(1, 0), 50, CG_ALL);
+    assert(!hit.hit);
+    assertNearlyEquals(Vector(50, 0), Vector(hit.distance, 0));
+  }
+}
+
+unittest("Physics: raycast hits the nearest matching body")
+{
+  auto physics = createPhysics();
+  physics->setEdifice(createEdifice());
+
+  Body near, far;
+  near.pos = Vector(5, 4);
+  near.size = Size(1, 2);
+  near.collisionGroup = 1;
+  far.pos = Vector(3, 4);
+  far.size = Size(1, 2);
+  far.collisionGroup = 2;
+  physics->addBody(&far);
+  physics->addBody(&near);
+
+  auto const origin = Vector(10, 5);
+  auto const left = Vector(-1, 0);
+
+  {
+    auto const hit = physics->raycast(origin, left, 100, 1);
+    assert(hit.body == &near);
+    assertNearlyEquals(Vector(4, 0), Vector(hit.distance, 0));
+    assertNearlyEquals(Vector(1, 0), hit.normal);
+  }
+
+  assert(physics->raycast(origin, left, 100, 2).body == &far);
+  assert(physics->raycast(origin, left, 100, 3).body == &near);
+  assert(physics->raycast(origin, left, 100, 3, &near).body == &far);
+  assert(physics->raycast(origin, left, 100, 4).body == nullptr);
+
+  // too far
+  assert(!physics->raycast(origin, left, 3, 3).hit);
+
+  // starting inside a body
+  {
+    auto const hit = physics->raycast(Vector(5.5, 5), left, 100, 1);
+    assert(hit.body == &near);
+    assertNearlyEquals(Vector(0, 0), Vector(hit.distance, 0));
+  }
+}
+
+unittest("Physics: raycast with an infinite range")
+{
+  auto physics = createPhysics();
+  physics->setEdifice(createEdifice());
+
+  auto const inf = numeric_limits<float>::infinity();
+
+  Body body;
+  body.pos = Vector(12, 4);
+  body.size = Size(1, 2);
+  physics->addBody(&body);
+
+  {
+    auto const hit = physics->raycast(Vector(10, 5), Vector(1, 0), inf, CG_ALL);
+    assert(hit.body == &body);
+    assertNearlyEquals(Vector(2, 0), Vector(hit.distance, 0));
+  }
+
+  // nothing to hit, in any direction
+  for(auto dir : { Vector(0, 1), Vector(1, 1), Vector(-1, 3), Vector(2, -7) })
+  {
+    auto const hit = physics->raycast(Vector(10, 5), dir, inf, 2);
+    assert(!hit.hit || hit.body == nullptr);
+  }
+
+  {
+    // beyond the edifice and the bodies
+    auto const hit = physics->raycast(Vector(1000, 1000), Vector(-1, -2), inf, CG_ALL);
+    assert(!hit.hit);
+  }
+
+  // a huge, but finite range
+  assert(!physics->raycast(Vector(10, 5), Vector(0, 1), 1e30, 2).hit);
+}
+
+#include "raycast_reference.h"
+
+unittest("Physics: raycast finds the same obstacles as box stepping")
+{
+  auto physics = createPhysics();
+  physics->setEdifice(createRaycastRoom());
+
+  uint32_t seed = 5;
+  vector<Body> bodies(40);
+
+  for(auto& body : bodies)
+  {
+    body.pos = Vector2f(20 + pseudoRandom(seed) % 400, 20 + pseudoRandom(seed) % 400) * 0.1;
+    body.size = Size2f(5 + pseudoRandom(seed) % 20, 5 + pseudoRandom(seed) % 20) * 0.1;
+    body.collisionGroup = 1 << (pseudoRandom(seed) % 2);
+    physics->addBody(&body);
+  }
+
+  auto const step = 0.01;
+
+  for(int k = 0; k < 200; ++k)
+  {
+    // never exactly on an edge, where both approaches disagree
+    auto const origin = Vector2f(20.5 + pseudoRandom(seed) % 400, 20.5 + pseudoRandom(seed) % 400) * 0.1;
+    auto const dir = Vector2f(pseudoRandom(seed) % 200 - 100, pseudoRandom(seed) % 200 - 100);
+    auto const mask = 1 + pseudoRandom(seed) % 3;
+
+    auto const hit = physics->raycast(origin, dir, 30, mask);
+    auto const expected = raycastByStepping(physics.get(), origin, dir, 30, mask, step);
+
+    assertEquals(expected.hit, hit.hit);
+    assertEquals(expected.body, hit.body);
+    assert(fabs(expected.distance - hit.distance) < step * 2);
+  }
+}
+
+unittest("Physics: tile attributes")
+{
+  auto physics = createPhysics();
+
+  Matrix2<int> attributes(Size2i(16, 16));
+  attributes.set(3, 2, 1 << TILE_HAZARD);
+  attributes.set(5, 2, 1 << TILE_CLIMBABLE);
+  attributes.set(5, 3, (1 << TILE_CLIMBABLE) | (1 << TILE_HAZARD));
+  physics->setTileAttributes(attributes);
+
+  auto const P = PRECISION;
+
+  // hazards are walls
+  Body body;
+  body.collidesWith = CG_WALLS;
+  assert(physics->isSolid(&body, IntBox(3 * P, 2 * P, 10, 10)));
+  assert(!physics->isSolid(&body, IntBox(5 * P, 2 * P, 10, 10)));
+  body.collidesWith = CG_DOORS;
+  assert(!physics->isSolid(&body, IntBox(3 * P, 2 * P, 10, 10)));
+
+  assert(physics->findTile(IntBox(3 * P, 2 * P, 10, 10), TILE_HAZARD));
+  assert(!physics->findTile(IntBox(3 * P, 2 * P, 10, 10), TILE_CLIMBABLE));
+  assert(!physics->findTile(IntBox(4 * P, 2 * P, P - 1, 10), TILE_CLIMBABLE));
+  assert(physics->findTile(IntBox(4 * P, 2 * P, P, 10), TILE_CLIMBABLE)); // touching
+
+  // the bottom row comes first
+  Vector2i cell;
+  assert(physics->findTile(IntBox(0, 0, 8 * P, 8 * P), TILE_CLIMBABLE, &cell));
+  assertEquals(5, cell.x);
+  assertEquals(2, cell.y);
+
+  assert(physics->findTile(IntBox(4 * P, 2 * P, 4 * P, 4 * P), TILE_HAZARD, &cell));
+  assertEquals(5, cell.x);
+  assertEquals(3, cell.y);
+}
+
+unittest("Physics: hazards don't fill their tile")
+{
+  auto physics = createPhysics();
+
+  Matrix2<int> attributes(Size2i(16, 16));
+  attributes.set(3, 2, 1 << TILE_HAZARD);
+  physics->setTileAttributes(attributes);
+
+  auto const P = PRECISION;
+  auto const top = 2 * P + int(HAZARD_HEIGHT * P);
+
+  Body body;
+  body.collidesWith = CG_WALLS;
+
+  // in the gap above the hazard, or touching its top from above
+  assert(!physics->isSolid(&body, IntBox(3 * P, top, 10, 10)));
+  assert(!physics->findTile(IntBox(3 * P, top, 10, 10), TILE_HAZARD));
+  assert(physics->isSolid(&body, IntBox(3 * P, top - 1, 10, 10)));
+  assert(physics->findTile(IntBox(3 * P, top - 1, 10, 10), TILE_HAZARD));
+
+  // falling on it: lands on its top
+  physics->addBody(&body);
+  body.pos = Vector2f(3, 4);
+  body.size = Size2f(1, 1);
+  physics->sweepBody(&body, Vector2f(0, -3));
+  assertNearlyEquals(Vector2f(3, 2 + HAZARD_HEIGHT), body.pos);
+
+  auto const hit = physics->raycast(Vector(3.5, 4), Vector(0, -1), 10, CG_WALLS);
+  assert(hit.hit);
+  assertNearlyEquals(Vector2f(2 - HAZARD_HEIGHT, 0), Vector2f(hit.distance, 0));
+}
@@ -0,0 +1,427 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Physics benchmarks.
+// Run with: tests.exe --benchmark Physics
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "engine/tests/tests.h"
+#include "base/util.h" // allPairs
+#include "src/body.h"
+#include "src/physics.h"
+#include "engine/src/misc/clock.h"
+#include "engine/src/misc/jobs.h"
+#include "engine/src/misc/random.h"
+
+using namespace std;
+
+namespace
+{
+// returns the average duration of one call to 'f', in seconds
+template<typename Lambda>
+double measure(Lambda f)
+{
+  auto const minDuration = 0.2;
+  auto const start = now();
+  int count = 0;
+
+  do
+  {
+    f();
+    ++count;
+  }
+  while(now() - start < minDuration);
+
+  return (now() - start) / count;
+}
+
+// prevents the compiler from optimizing away the benchmarked computations
+volatile int g_sink;
+
+// same density whatever the body count: ~1 body per 16 square units
+void scatterBodies(vector<Body>& bodies)
+{
+  auto const side = (int)sqrt(bodies.size() * 16.0);
+  uint32_t seed = 1234;
+
+  auto rnd = [&] () { return pseudoRandom(seed); };
+
+  for(auto& body : bodies)
+  {
+    body.pos = Vector2f(rnd() % (side * 10), rnd() % (side * 10)) * 0.1;
+    body.size = Size2f(5 + rnd() % 15, 5 + rnd() % 15) * 0.1;
+  }
+}
+}
+
+benchmark("Physics: checkForOverlaps scaling")
+{
+  for(auto n : { 100, 300, 1000, 3000, 10000 })
+  {
+    vector<Body> bodies(n);
+    scatterBodies(bodies);
+
+    auto physics = createPhysics();
+
+    for(auto& body : bodies)
+      physics->addBody(&body);
+
+    int hits = 0;
+
+    auto bruteForce = [&] ()
+      {
+        for(auto p : allPairs(n))
+          if(overlaps(bodies[p.first].getBox(), bodies[p.second].getBox()))
+            ++hits;
+      };
+
+    auto const gridTime = measure([&] () { physics->checkForOverlaps(); });
+    auto const bruteTime = measure(bruteForce);
+
+    printf("  %5d bodies: broadphase %9.3f ms/pass, brute force %9.3f ms/pass (x%.1f)\n",
+           n, gridTime * 1000.0, bruteTime * 1000.0, bruteTime / gridTime);
+    g_sink = hits;
+  }
+}
+
+benchmark("Physics: checkForOverlaps, deferred contacts")
+{
+  vector<Body> bodies(10000);
+  scatterBodies(bodies);
+
+  for(auto threads : { 1, 2, 4 })
+  {
+    JobSystem jobs(threads - 1);
+
+    auto physics = createPhysics();
+    physics->setDeferredContacts(true, &jobs);
+
+    for(auto& body : bodies)
+      physics->addBody(&body);
+
+    auto const time = measure([&] () { physics->checkForOverlaps(); });
+
+    printf("  %d detection thread(s): %9.3f ms/pass\n", threads, time * 1000.0);
+  }
+}
+
+benchmark("Physics: checkForOverlaps, 10% of the bodies moving")
+{
+  for(auto n : { 100, 1000, 10000 })
+  {
+    vector<Body> bodies(n);
+    scatterBodies(bodies);
+
+    auto physics = createPhysics();
+
+    for(auto& body : bodies)
+      physics->addBody(&body);
+
+    int tick = 0;
+
+    auto moveAll = [&] ()
+      {
+        auto const delta = Vector(tick++ % 2 ? -0.5 : 0.5, 0);
+
+        for(auto& body : bodies)
+          physics->moveBody(&body, delta);
+
+        physics->checkForOverlaps();
+      };
+
+    auto moveSome = [&] ()
+      {
+        auto const delta = Vector(tick++ % 2 ? -0.5 : 0.5, 0);
+
+        for(int i = 0; i < n; i += 10)
+          physics->moveBody(&bodies[i], delta);
+
+        physics->checkForOverlaps();
+      };
+
+    auto const allTime = measure(moveAll);
+    auto const allStats = physics->getStats();
+
+    auto const someTime = measure(moveSome);
+    auto const someStats = physics->getStats();
+
+    printf("  %5d bodies: all moving %8.3f ms/tick (%d pairs tested), 10%% moving %8.3f ms/tick (%d pairs tested, %d skipped)\n",
+           n, allTime * 1000.0, allStats.testedPairs, someTime * 1000.0, someStats.testedPairs, someStats.skippedPairs);
+  }
+}
+
+benchmark("Physics: getBodiesInBox")
+{
+  for(auto n : { 100, 1000, 10000 })
+  {
+    vector<Body> bodies(n);
+    scatterBodies(bodies);
+
+    auto physics = createPhysics();
+
+    for(auto& body : bodies)
+      physics->addBody(&body);
+
+    int i = 0;
+    Body* found = nullptr;
+
+    auto indexed = [&] ()
+      {
+        auto box = bodies[i++ % n].getBox();
+        found = physics->getBodiesInBox(box, -1, true);
+      };
+
+    auto linearScan = [&] ()
+      {
+        auto box = bodies[i++ % n].getBox();
+        found = nullptr;
+
+        for(auto& body : bodies)
+          if(body.solid && overlaps(body.getBox(), box))
+          {
+            found = &body;
+            break;
+          }
+      };
+
+    auto const indexedTime = measure(indexed);
+    auto const linearTime = measure(linearScan);
+
+    printf("  %5d bodies: indexed %9.3f us/query, linear scan %9.3f us/query (x%.1f)\n",
+           n, indexedTime * 1e6, linearTime * 1e6, linearTime / indexedTime);
+    g_sink = found != nullptr;
+  }
+}
+
+#include "src/collision_groups.h"
+
+benchmark("Physics: collision group buckets")
+{
+  // mostly walls, which only collide with the players
+  vector<Body> bodies(3000);
+  scatterBodies(bodies);
+
+  auto physics = createPhysics();
+
+  for(int i = 0; i < (int)bodies.size(); ++i)
+  {
+    auto& body = bodies[i];
+    auto const isPlayer = i % 100 == 0;
+    body.collisionGroup = isPlayer ? CG_PLAYER : CG_WALLS;
+    body.collidesWith = isPlayer ? CG_WALLS : CG_PLAYER;
+    physics->addBody(&body);
+  }
+
+  int i = 0;
+  Body* found = nullptr;
+
+  auto query = [&] (int mask)
+    {
+      auto box = bodies[i++ % bodies.size()].getBox();
+      box.size = box.size * 4;
+      found = physics->getBodiesInBox(box, mask);
+    };
+
+  auto const playersTime = measure([&] () { query(CG_PLAYER); });
+  auto const allTime = measure([&] () { query(CG_ALL); });
+
+  printf("  query CG_PLAYER: %7.3f us, query CG_ALL: %7.3f us (x%.1f)\n",
+         playersTime * 1e6, allTime * 1e6, allTime / playersTime);
+
+  // everything is awake on the first pass: only walls/players pairs get tested
+  physics->checkForOverlaps();
+  auto const stats = physics->getStats();
+
+  printf("  checkForOverlaps, first pass: %d pairs tested among %d bodies\n", stats.testedPairs, stats.awakeBodies);
+  g_sink = found != nullptr;
+}
+
+#include "src/solidity_map.h"
+
+benchmark("Physics: tile solidity (Matrix2 vs SolidityMap)")
+{
+  // typical room: 3x2 cells of 16x16 tiles, with a floor and a ceiling
+  Matrix2<int> tiles(Size2i(48, 32));
+
+  tiles.scan([&] (int x, int y, int)
+    {
+      if(y < 2 || y >= 26 || (x % 16 >= 7 && x % 16 < 9 && y % 4 == 0))
+        tiles.set(x, y, 1);
+    });
+
+  SolidityMap map(tiles);
+
+  auto isBoxSolidMatrix = [&] (IntBox box)
+    {
+      auto const col1 = box.pos.x / PRECISION;
+      auto const col2 = (box.pos.x + box.size.width) / PRECISION;
+      auto const row1 = box.pos.y / PRECISION;
+      auto const row2 = (box.pos.y + box.size.height) / PRECISION;
+
+      for(int row = row1; row <= row2; row++)
+        for(int col = col1; col <= col2; col++)
+          if(tiles.isInside(col, row) && tiles.get(col, row))
+            return true;
+
+      return false;
+    };
+
+  // player-sized boxes, sweeping through the room
+  vector<IntBox> boxes;
+
+  for(int y = 0; y < 30 * 4; ++y)
+    for(int x = 0; x < 46 * 4; ++x)
+      boxes.push_back(roundBox(Box(Vector(x * 0.25, y * 0.25), Size(0.7, 1.9))));
+
+  int hits = 0;
+  auto const matrixTime = measure([&] () { for(auto& box : boxes) hits += isBoxSolidMatrix(box); });
+  auto const bitsTime = measure([&] () { for(auto& box : boxes) hits += map.isBoxSolid(box); });
+
+  printf("  Matrix2: %7.2f ns/test, SolidityMap: %7.2f ns/test (x%.1f)\n",
+         matrixTime * 1e9 / boxes.size(), bitsTime * 1e9 / boxes.size(), matrixTime / bitsTime);
+  g_sink = hits;
+}
+
+benchmark("Physics: 10 sub-stepped moveBody vs one sweepBody per tick")
+{
+  Matrix2<int> tiles(Size2i(64, 64));
+
+  tiles.scan([&] (int x, int y, int)
+    {
+      if(y < 2 || x < 2 || x >= 62 || (x % 16 >= 7 && x % 16 < 9 && y % 4 == 0))
+        tiles.set(x, y, 1);
+    });
+
+  vector<Body> bodies(200);
+  scatterBodies(bodies);
+
+  auto physics = createPhysics();
+  physics->setEdifice(SolidityMap(tiles));
+
+  for(auto& body : bodies)
+  {
+    body.pos = Vector(4 + fmod(body.pos.x, 56), 4 + fmod(body.pos.y, 56));
+    body.size = Size(0.7, 1.9);
+    physics->addBody(&body);
+  }
+
+  auto const vel = Vector(0.2, -0.15);
+  int tick = 0;
+
+  auto subSteps = [&] ()
+    {
+      auto const sign = (tick++ % 2) ? -1 : 1;
+
+      for(auto& body : bodies)
+        for(int i = 0; i < 10; ++i)
+          physics->moveBody(&body, vel * (sign * 0.1));
+    };
+
+  auto swept = [&] ()
+    {
+      auto const sign = (tick++ % 2) ? -1 : 1;
+
+      for(auto& body : bodies)
+        physics->sweepBody(&body, vel * sign);
+    };
+
+  auto const subStepsTime = measure(subSteps);
+  auto const sweptTime = measure(swept);
+
+  printf("  %d bodies: sub-steps %8.3f us/tick, swept %8.3f us/tick (x%.1f)\n",
+         (int)bodies.size(), subStepsTime * 1e6, sweptTime * 1e6, subStepsTime / sweptTime);
+}
+
+#include "src/overlap_kernel.h"
+
+benchmark("Physics: batched overlap kernel (SIMD vs scalar)")
+{
+  for(auto n : { 64, 256, 1024 })
+  {
+    vector<Body> bodies(n);
+    scatterBodies(bodies);
+
+    vector<int> x1, y1, x2, y2;
+
+    for(auto& body : bodies)
+    {
+      auto const box = body.getBox();
+      x1.push_back(box.pos.x);
+      y1.push_back(box.pos.y);
+      x2.push_back(box.pos.x + box.size.width);
+      y2.push_back(box.pos.y + box.size.height);
+    }
+
+    int i = 0;
+    int hits = 0;
+
+    // one query box against all the bodies, 64 at a time
+    auto scan = [&] (decltype(&overlapMask) kernel)
+      {
+        auto const query = bodies[i++ % n].getBox();
+
+        for(int first = 0; first < n; first += 64)
+          hits += kernel(query, &x1[first], &y1[first], &x2[first], &y2[first], 64) != 0;
+      };
+
+    auto perBody = [&] ()
+      {
+        auto const query = bodies[i++ % n].getBox();
+
+        for(auto& body : bodies)
+          hits += overlaps(body.getBox(), query);
+      };
+
+    auto const simdTime = measure([&] () { scan(&overlapMask); });
+    auto const scalarTime = measure([&] () { scan(&overlapMaskScalar); });
+    auto const perBodyTime = measure(perBody);
+
+    printf("  %4d bodies: kernel %8.3f us/query, scalar kernel %8.3f us/query (x%.1f), per-body 'overlaps' %8.3f us/query (x%.1f)\n",
+           n, simdTime * 1e6, scalarTime * 1e6, scalarTime / simdTime, perBodyTime * 1e6, perBodyTime / simdTime);
+    g_sink = hits;
+  }
+}
+
+#include "raycast_reference.h"
+
+benchmark("Physics: raycast vs box stepping")
+{
+  vector<Body> bodies(200);
+  scatterBodies(bodies);
+
+  auto physics = createPhysics();
+  physics->setEdifice(createRaycastRoom());
+
+  for(auto& body : bodies)
+  {
+    body.pos = Vector(3 + fmod(body.pos.x, 56), 3 + fmod(body.pos.y, 56));
+    physics->addBody(&body);
+  }
+
+  for(auto maxDist : { 5.0f, 20.0f, 80.0f })
+  {
+    int i = 0;
+    int hits = 0;
+
+    auto nextDir = [&] ()
+      {
+        auto const angle = (i++ % 64) * 0.098;
+        return Vector(cos(angle), sin(angle));
+      };
+
+    auto const origin = Vector(31.5, 31.5);
+
+    auto const dda = measure([&] () { hits += physics->raycast(origin, nextDir(), maxDist, -1).hit; });
+    auto const stepping = measure([&] () { hits += raycastByStepping(physics.get(), origin, nextDir(), maxDist, -1, 0.1).hit; });
+
+    printf("  max distance %4.0f: raycast %8.3f us, stepping by 0.1 %8.3f us (x%.1f)\n",
+           maxDist, dda * 1e6, stepping * 1e6, stepping / dda);
+    g_sink = hits;
+  }
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+// Naive raycast: steps a tiny box along the ray, using
+// 'getBodiesInBox' and 'isSolid' at each step.
+// Used as a reference by the tests and the benchmarks.
+
+#pragma once
+
+#include <cmath>
+#include "src/physics.h"
+
+// 64x64 room: walls all around, and a few pillars
+inline SolidityMap createRaycastRoom()
+{
+  Matrix2<int> tiles(Size2i(64, 64));
+
+  tiles.scan([&] (int x, int y, int& tile)
+    {
+      tile = x < 2 || y < 2 || x >= 62 || y >= 62 || (x % 16 == 8 && y % 16 < 4);
+    });
+
+  return SolidityMap(tiles);
+}
+
+inline RayHit raycastByStepping(IPhysicsProbe* physics, Vector origin, Vector dir, float maxDist, int mask, double step)
+{
+  Body probe;
+  probe.collidesWith = 0; // only the tiles
+
+  auto const length = sqrt(dir.x * dir.x + dir.y * dir.y);
+
+  RayHit r;
+  r.distance = maxDist;
+
+  for(double dist = 0; dist <= maxDist; dist += step)
+  {
+    auto const p = origin + dir * float(dist / length);
+    auto box = roundBox(Box(p, Size(0, 0)));
+    box.size = Size2i(1, 1);
+
+    if(physics->isSolid(&probe, box))
+    {
+      r.hit = true;
+      r.distance = dist;
+      return r;
+    }
+
+    if(auto body = physics->getBodiesInBox(box, mask))
+    {
+      r.hit = true;
+      r.distance = dist;
+      r.body = body;
+      return r;
+    }
+  }
+
+  return r;
+}
@@ -0,0 +1,98 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/tests/tests.h"
+#include "src/room_cache.h"
+#include "src/entities/explosion.h"
+
+namespace
+{
+struct CountingGame : IGame
+{
+  void textBox(char const*) override {}
+  void playSound(SOUND) override { ++sounds; }
+  void setAmbientLight(float) override {}
+  void stopMusic() override {}
+  void spawn(Entity* e) override { delete e; }
+  IVariable* getVariable(int) override { return nullptr; }
+  void postEvent(int, const void*, int) override {}
+  Vector getPlayerPosition() override { return Vector(0, 0); }
+  void respawn() override {}
+  int random() override { return 0; }
+
+  int sounds = 0;
+};
+
+// one entity: one chunk
+unique_ptr<PreparedRoom> createRoom(int levelIdx)
+{
+  auto room = make_unique<PreparedRoom>();
+  room->levelIdx = levelIdx;
+  room->pool = make_unique<EntityPool>();
+  room->physics = createPhysics();
+
+  EntityPoolScope scope(room->pool.get());
+  room->entities.push_back(makeExplosion());
+
+  return room;
+}
+
+auto const CHUNK = createRoom(0)->pool->memoryUsage();
+}
+
+unittest("RoomCache: least recently used rooms are dropped first")
+{
+  CountingGame game;
+  RoomCache cache(&game, 2 * CHUNK);
+
+  cache.suspend(createRoom(0));
+  cache.suspend(createRoom(1));
+  assertEquals(int(2 * CHUNK), (int)cache.memoryUsage());
+
+  // revisit room 0: room 1 becomes the least recently used
+  auto room = cache.take(0);
+  assert(room != nullptr);
+  assert(room->suspended);
+  cache.suspend(move(room));
+
+  cache.suspend(createRoom(2));
+  assert(cache.contains(0));
+  assert(!cache.contains(1));
+  assert(cache.contains(2));
+
+  assert(cache.take(1) == nullptr);
+  assertEquals(1, cache.hits);
+  assertEquals(1, cache.misses);
+  assertEquals(1, cache.evictions);
+}
+
+unittest("RoomCache: no budget, no cache")
+{
+  CountingGame game;
+  RoomCache cache(&game, 0);
+
+  cache.suspend(createRoom(3));
+  assert(!cache.contains(3));
+  assertEquals(0, (int)cache.memoryUsage());
+  assertEquals(1, cache.evictions);
+}
+
+unittest("RoomCache: suspended entities are muted")
+{
+  CountingGame game;
+  RoomCache cache(&game, 2 * CHUNK);
+
+  auto room = createRoom(4);
+  auto const entity = room->entities[0].get();
+  cache.suspend(move(room));
+
+  entity->game->playSound(0);
+  assertEquals(0, game.sounds);
+
+  room = cache.take(4);
+  assert(entity->game == &game);
+}
+
@@ -0,0 +1,105 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/tests/tests.h"
+#include "src/room_streamer.h"
+#include "src/spawn_program.h"
+
+static
+Room createRoom(vector<string> spawnerNames)
+{
+  Room room;
+  room.size = Size2i(1, 1);
+  room.tiles.resize(Size2i(16, 16));
+
+  int x = 0;
+
+  for(auto& name : spawnerNames)
+    room.spawners.push_back({ Vector(x++, 3), name });
+
+  return room;
+}
+
+static
+shared_ptr<const Quest> createQuest()
+{
+  auto quest = make_shared<Quest>();
+  quest->rooms.push_back(createRoom({ "room_boundary_detector(1,16,0)" }));
+  quest->rooms.push_back(createRoom({ "room_boundary_detector(0,-16,0)", "spider", "room_boundary_detector(2,0,16)", "room_boundary_detector(0,-16,8)" }));
+  quest->rooms.push_back(createRoom({ "room_boundary_detector(1,0,-16)", "blocker" }));
+  compileSpawnPrograms(*quest);
+  return quest;
+}
+
+unittest("RoomStreamer: adjacent rooms are the targets of the boundary detectors")
+{
+  auto quest = createQuest();
+
+  auto const adjacent = getAdjacentRooms(quest->rooms[1]);
+  assertEquals(2, (int)adjacent.size());
+  assertEquals(0, adjacent[0]);
+  assertEquals(2, adjacent[1]);
+
+  assertEquals(1, (int)getAdjacentRooms(quest->rooms[2]).size());
+}
+
+unittest("RoomStreamer: prepared rooms aren't entered yet")
+{
+  auto quest = createQuest();
+  auto room = prepareRoom(*quest, 2);
+
+  assertEquals(2, room->levelIdx);
+  assertEquals(2, (int)room->entities.size());
+  assertEquals(2, room->pool->liveBlocks());
+
+  assertEquals(2000, room->entities[0]->id);
+  assertEquals(2001, room->entities[1]->id);
+  assertEquals(1.0f, room->entities[1]->pos.x);
+
+  for(auto& entity : room->entities)
+    assert(entity->game == nullptr);
+}
+
+unittest("RoomStreamer: prepared rooms simulate in fixed-point")
+{
+  auto quest = createQuest();
+  auto room = prepareRoom(*quest, 0);
+
+  Body body;
+  body.pos = Vector(5, 5);
+  room->physics->addBody(&body);
+
+  // same result on every build: snapped to whole PRECISION units
+  room->physics->moveBody(&body, Vector(0.3, 0));
+  assertEquals(5.0f + 307.0f / PRECISION, body.pos.x);
+}
+
+unittest("RoomStreamer: prefetched and unexpected rooms")
+{
+  auto quest = createQuest();
+  RoomStreamer streamer(quest);
+
+  streamer.prefetch(getAdjacentRooms(quest->rooms[1]));
+
+  auto prefetched = streamer.take(2);
+  assertEquals(2, prefetched->levelIdx);
+  assertEquals(1, streamer.hits);
+  assertEquals(0, streamer.misses);
+
+  // taken: not prepared anymore
+  auto again = streamer.take(2);
+  assertEquals(2, again->levelIdx);
+  assertEquals((int)prefetched->entities.size(), (int)again->entities.size());
+  assertEquals(1, streamer.misses);
+
+  // room 1 isn't in this neighbourhood
+  streamer.prefetch(getAdjacentRooms(quest->rooms[2]));
+  streamer.take(1);
+  assertEquals(2, streamer.hits);
+  streamer.take(0);
+  assertEquals(2, streamer.misses);
+}
+
@@ -0,0 +1,129 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/tests/tests.h"
+#include "src/solidity_map.h"
+#include "engine/src/misc/random.h"
+#include <cmath>
+
+namespace
+{
+// per-tile reference implementation
+bool isBoxSolidSlow(Matrix2<int> const& tiles, IntBox box)
+{
+  auto const col1 = (int)floor(box.pos.x / double(PRECISION));
+  auto const col2 = (int)floor((box.pos.x + box.size.width) / double(PRECISION));
+  auto const row1 = (int)floor(box.pos.y / double(PRECISION));
+  auto const row2 = (int)floor((box.pos.y + box.size.height) / double(PRECISION));
+
+  for(int row = row1; row <= row2; row++)
+    for(int col = col1; col <= col2; col++)
+      if(tiles.isInside(col, row) && tiles.get(col, row))
+        return true;
+
+  return false;
+}
+}
+
+unittest("SolidityMap: single tile")
+{
+  Matrix2<int> tiles(Size2i(100, 10));
+  tiles.set(70, 3, 1);
+
+  SolidityMap map(tiles);
+
+  assert(map.isSolid(70, 3));
+  assert(!map.isSolid(69, 3));
+  assert(!map.isSolid(70, 4));
+  assert(!map.isSolid(-1, 0));
+  assert(!map.isSolid(100, 0));
+
+  assert(map.isRangeSolid(0, 0, 99, 9));
+  assert(map.isRangeSolid(70, 3, 70, 3));
+  assert(map.isRangeSolid(-10, -10, 70, 3));
+  assert(!map.isRangeSolid(0, 0, 69, 9));
+  assert(!map.isRangeSolid(71, 0, 200, 9));
+  assert(!map.isRangeSolid(0, 4, 99, 9));
+
+  // touching the left edge of the tile
+  assert(map.isBoxSolid(IntBox(69 * PRECISION, 3 * PRECISION, PRECISION, 10)));
+  assert(!map.isBoxSolid(IntBox(69 * PRECISION, 3 * PRECISION, PRECISION - 1, 10)));
+}
+
+unittest("SolidityMap: same result as per-tile tests")
+{
+  uint32_t seed = 42;
+
+  for(auto width : { 1, 63, 64, 65, 200 })
+  {
+    Matrix2<int> tiles(Size2i(width, 20));
+
+    tiles.scan([&] (int x, int y, int) { tiles.set(x, y, pseudoRandom(seed) % 13 == 0 ? 1 + pseudoRandom(seed) % 4 : 0); });
+
+    SolidityMap map(tiles);
+
+    for(int i = 0; i < 2000; ++i)
+    {
+      IntBox box;
+      box.pos.x = (pseudoRandom(seed) % (width + 8) - 4) * PRECISION + pseudoRandom(seed) % PRECISION;
+      box.pos.y = (pseudoRandom(seed) % 28 - 4) * PRECISION + pseudoRandom(seed) % PRECISION;
+      box.size.width = pseudoRandom(seed) % (5 * PRECISION);
+      box.size.height = pseudoRandom(seed) % (5 * PRECISION);
+
+      assertEquals(isBoxSolidSlow(tiles, box), map.isBoxSolid(box));
+    }
+  }
+}
+
+unittest("SolidityMap: origin")
+{
+  Matrix2<int> tiles(Size2i(4, 4));
+  tiles.set(0, 0, 1);
+
+  SolidityMap map(tiles, Vector2i(-10, 5));
+
+  assert(map.isBoxSolid(IntBox(-10 * PRECISION, 5 * PRECISION, 10, 10)));
+  assert(!map.isBoxSolid(IntBox(-9 * PRECISION, 5 * PRECISION, 10, 10)));
+  assert(!map.isBoxSolid(IntBox(0, 0, 10, 10)));
+}
+
+unittest("SolidityMap: mask")
+{
+  Matrix2<int> tiles(Size2i(4, 4));
+  tiles.set(1, 1, 1);
+  tiles.set(2, 1, 2);
+  tiles.set(3, 1, 3);
+
+  SolidityMap map(tiles, Vector2i(0, 0), 2);
+
+  assert(!map.isSolid(1, 1));
+  assert(map.isSolid(2, 1));
+  assert(map.isSolid(3, 1));
+}
+
+unittest("SolidityMap: negative coordinates")
+{
+  Matrix2<int> tiles(Size2i(4, 4));
+  tiles.set(0, 0, 1);
+
+  SolidityMap map(tiles, Vector2i(-1, -1));
+
+  // inside the tile (-1;-1)
+  assert(map.isBoxSolid(IntBox(-PRECISION / 2, -PRECISION / 2, 10, 10)));
+  assert(map.isBoxSolid(IntBox(-PRECISION, -PRECISION, 1, 1)));
+
+  // inside the tile (0;0)
+  assert(!map.isBoxSolid(IntBox(0, 0, 10, 10)));
+
+  int count = 0;
+  map.scanSolidTiles(IntBox(-PRECISION / 2, -PRECISION / 2, 10, 10), [&] (int col, int row) { assertEquals(-1, col); assertEquals(-1, row); ++count; });
+  assertEquals(1, count);
+
+  assertEquals(-1, SolidityMap::toTile(-1));
+  assertEquals(-1, SolidityMap::toTile(-PRECISION));
+  assertEquals(-2, SolidityMap::toTile(-PRECISION - 1));
+  assertEquals(0, SolidityMap::toTile(PRECISION - 1));
+}
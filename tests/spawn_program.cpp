@@ -0,0 +1,117 @@
+// Copyright (C) 2019 - Sebastien Alaiwan
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as
+// published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+
+#include "engine/tests/tests.h"
+#include "src/entity.h"
+#include "src/entity_factory.h"
+#include "src/spawn_program.h"
+
+namespace
+{
+// keeps what it was configured with
+struct ConfigProbe : Entity
+{
+  void addActors(vector<Actor> &) const override {}
+
+  int first = 0;
+  int second = 0;
+  string secondText;
+  int link = 0;
+};
+
+unique_ptr<Entity> makeConfigProbe(IEntityConfig* cfg)
+{
+  auto probe = make_unique<ConfigProbe>();
+  probe->first = cfg->getInt(0);
+  probe->second = cfg->getInt(1, -1);
+  probe->secondText = cfg->getString(1, "none");
+  probe->link = cfg->getInt(2, -1);
+  return probe;
+}
+
+auto const reg = registerEntity("test_config_probe", &makeConfigProbe, { "0", "1", "link" });
+
+bool compiles(string name)
+{
+  try
+  {
+    compileSpawners({ { Vector(0, 0), name } });
+    return true;
+  }
+  catch(exception const &)
+  {
+    return false;
+  }
+}
+
+bool spawns(string name)
+{
+  Room room;
+  room.spawners.push_back({ Vector(0, 0), name });
+  room.program = compileSpawners(room.spawners);
+
+  try
+  {
+    runSpawnProgram(room, 0);
+    return true;
+  }
+  catch(exception const &)
+  {
+    return false;
+  }
+}
+}
+
+unittest("SpawnProgram: arguments and config")
+{
+  Room room;
+  room.spawners.push_back({ Vector(3, 4), "test_config_probe(12,\"abc\")", { { "link", "7" }, { "0", "99" } } });
+  room.spawners.push_back({ Vector(5, 6), "test_config_probe" });
+  room.program = compileSpawners(room.spawners);
+
+  auto entities = runSpawnProgram(room, 4000);
+  assertEquals(2, (int)entities.size());
+
+  auto probe = dynamic_cast<ConfigProbe*>(entities[0].get());
+  assert(probe);
+  assertEquals(4000, probe->id);
+  assertEquals(3.0f, probe->pos.x);
+  assertEquals(12, probe->first); // the call overrides the config
+  assertEquals(0, probe->second);
+  assertEquals(string("abc"), probe->secondText);
+  assertEquals(7, probe->link);
+
+  probe = dynamic_cast<ConfigProbe*>(entities[1].get());
+  assertEquals(4001, probe->id);
+  assertEquals(-1, probe->second);
+  assertEquals(string("none"), probe->secondText);
+  assertEquals(-1, probe->link);
+}
+
+unittest("SpawnProgram: errors")
+{
+  assert(compiles("test_config_probe(1,2") == false);
+  assert(compiles("test_config_probe(1,2)"));
+
+  // resolved when compiled, only fail when actually spawned
+  assert(compiles("no_such_entity"));
+  assertEquals(-1, compileSpawners({ { Vector(0, 0), "no_such_entity" } }).ops[0].factory);
+  assert(spawns("no_such_entity") == false);
+  assert(spawns("test_config_probe(1,2)"));
+}
+
+unittest("SpawnProgram: arguments are resolved in parameter order")
+{
+  auto program = compileSpawners({ { Vector(0, 0), "test_config_probe(5)", { { "link", "8" }, { "unused", "9" } } } });
+
+  auto& op = program.ops[0];
+  assertEquals(3, op.argCount);
+
+  assertEquals(5, getSpawnArg(program, op, 0)->value);
+  assert(getSpawnArg(program, op, 1) == nullptr);
+  assertEquals(8, getSpawnArg(program, op, 2)->value);
+}
+